@@ -90,7 +90,8 @@
 #define INITSCALEMTOF (.2*FRACUNIT)
 // how much the automap moves window per tic in frame-buffer coordinates
 // moves 140 pixels in 1 second
-#define F_PANINC	4
+// SOKOL CHANGE: pixels at 320x200
+#define F_PANINC	(4*screenscale)
 // how much zoom-in per tic
 // goes to 2x in 1 second
 #define M_ZOOMIN        ((int) (1.02*FRACUNIT))
@@ -198,8 +199,8 @@ static int 	grid = 0;
 static int 	leveljuststarted = 1; 	// kluge until AM_LevelInit() is called
 
 boolean    	automapactive = false;
-static int 	finit_width = SCREENWIDTH;
-static int 	finit_height = SCREENHEIGHT - 32;
+static int 	finit_width;
+static int 	finit_height;
 
 // location of window on screen
 static int 	f_x;
@@ -519,6 +520,10 @@ void AM_LevelInit(void)
 {
     leveljuststarted = 0;
 
+    // SOKOL CHANGE: the render resolution is only known at runtime
+    finit_width = SCREENWIDTH;
+    finit_height = SCREENHEIGHT - 32*screenscale;
+
     f_x = f_y = 0;
     f_w = finit_width;
     f_h = finit_height;
@@ -1320,10 +1325,14 @@ void AM_drawMarks(void)
 	    //      h = SHORT(marknums[i]->height);
 	    w = 5; // because something's wrong with the wad, i guess
 	    h = 6; // because something's wrong with the wad, i guess
+	    // SOKOL CHANGE: patches are placed in 320x200 units
+	    w *= screenscale;
+	    h *= screenscale;
 	    fx = CXMTOF(markpoints[i].x);
 	    fy = CYMTOF(markpoints[i].y);
 	    if (fx >= f_x && fx <= f_w - w && fy >= f_y && fy <= f_h - h)
-		V_DrawPatch(fx, fy, marknums[i]);
+		V_DrawPatch(fx/screenscale - widescreendelta, fy/screenscale,
+			    marknums[i]);
 	}
     }
 
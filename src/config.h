@@ -37,7 +37,20 @@
 #undef HAVE_MEMORY_H
 
 /* Define to 1 if you have the `mmap' function. */
+/* SOKOL CHANGE: native POSIX builds */
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(__EMSCRIPTEN__)
+#define HAVE_MMAP 1
+#else
 #undef HAVE_MMAP
+#endif
+
+/* Define to 1 if you have POSIX threads. */
+/* SOKOL CHANGE: native POSIX builds */
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(__EMSCRIPTEN__)
+#define HAVE_PTHREAD 1
+#else
+#undef HAVE_PTHREAD
+#endif
 
 /* Define to 1 if you have the `sched_setaffinity' function. */
 #undef HAVE_SCHED_SETAFFINITY
@@ -46,10 +46,12 @@
 #include "f_wipe.h"
 
 #include "m_argv.h"
+#include "m_bench.h"
 #include "m_config.h"
 #include "m_controls.h"
 #include "m_misc.h"
 #include "m_menu.h"
+#include "m_profile.h"
 #include "p_saveg.h"
 
 #include "i_endoom.h"
@@ -98,6 +100,7 @@ boolean		devparm;	// started game with -devparm
 boolean         nomonsters;	// checkparm of -nomonsters
 boolean         respawnparm;	// checkparm of -respawn
 boolean         fastparm;	// checkparm of -fast
+boolean         vanillathinkers;	// checkparm of -vanillathinkers
 
 //extern int soundVolume;
 //extern  int	sfxVolume;
@@ -163,19 +166,22 @@ extern  boolean setsizeneeded;
 extern  int             showMessages;
 void R_ExecuteSetViewSize (void);
 
+// SOKOL CHANGE
+// The wiping effect was a modal loop at the end of the D_Display()
+// function, which doesn't work in a frame callback scenario. Thus
+// the wipe effect has been sliced and the D_Display() function split
+// into a "wiping" and "non-wiping" state which can be called per frame
+static bool wiping = false;
+
 void D_Display (void)
 {
-    // SOKOL CHANGE
-    // The wiping effect was a modal loop at the end of the D_Display()
-    // function, which doesn't work in a frame callback scenario. Thus
-    // the wipe effect has been sliced and the D_Display() function split
-    // into a "wiping" and "non-wiping" state which can be called per frame
-    static bool wiping = false;
     if (wiping) {
         wiping = !wipe_ScreenWipe(wipe_Melt, 0, 0, SCREENWIDTH, SCREENHEIGHT, 1);
         I_UpdateNoBlit ();
         M_Drawer ();                            // menu is drawn even on top of wipes
+        M_BenchBeginPhase (bench_present);
         I_FinishUpdate ();                      // page flip or blit buffer
+        M_BenchEndPhase (bench_present);
     }
     else {
         // regular D_Display code
@@ -214,6 +220,11 @@ void D_Display (void)
         if (gamestate == GS_LEVEL && gametic)
             HU_Erase();
 
+        // SOKOL CHANGE: the other screens only cover the middle
+        //  of a wide screen, clear the sides
+        if (widescreendelta && gamestate != GS_LEVEL)
+            memset(I_VideoBuffer, 0, SCREENWIDTH*SCREENHEIGHT);
+
         // do buffered drawing
         switch (gamestate)
         {
@@ -222,12 +233,12 @@ void D_Display (void)
                 break;
             if (automapactive)
                 AM_Drawer ();
-            if (wipe || (viewheight != 200 && fullscreen) )
+            if (wipe || (viewheight != SCREENHEIGHT && fullscreen) )
                 redrawsbar = true;
             if (inhelpscreensstate && !inhelpscreens)
                 redrawsbar = true;              // just put away the help screen
-            ST_Drawer (viewheight == 200, redrawsbar );
-            fullscreen = viewheight == 200;
+            ST_Drawer (viewheight == SCREENHEIGHT, redrawsbar );
+            fullscreen = viewheight == SCREENHEIGHT;
             break;
 
           case GS_INTERMISSION:
@@ -248,7 +259,11 @@ void D_Display (void)
 
         // draw the view directly
         if (gamestate == GS_LEVEL && !automapactive && gametic)
+        {
+            M_BenchBeginPhase (bench_render);
             R_RenderPlayerView (&players[displayplayer]);
+            M_BenchEndPhase (bench_render);
+        }
 
         if (gamestate == GS_LEVEL && gametic)
             HU_Drawer ();
@@ -265,7 +280,7 @@ void D_Display (void)
         }
 
         // see if the border needs to be updated to the screen
-        if (gamestate == GS_LEVEL && !automapactive && scaledviewwidth != 320)
+        if (gamestate == GS_LEVEL && !automapactive && scaledviewwidth != SCREENWIDTH)
         {
             if (menuactive || menuactivestate || !viewactivestate)
                 borderdrawcount = 3;
@@ -289,13 +304,15 @@ void D_Display (void)
         oldgamestate = wipegamestate = gamestate;
 
         // draw pause pic
+        // SOKOL CHANGE: patches are placed in 320x200 units
         if (paused)
         {
             if (automapactive)
                 y = 4;
             else
-                y = viewwindowy+4;
-            V_DrawPatchDirect(viewwindowx + (scaledviewwidth - 68) / 2, y,
+                y = viewwindowy/screenscale+4;
+            V_DrawPatchDirect((viewwindowx + (scaledviewwidth - 68*screenscale) / 2)
+                                  / screenscale - widescreendelta, y,
                                   W_CacheLumpName (DEH_String("M_PAUSE"), PU_CACHE));
         }
 
@@ -309,7 +326,9 @@ void D_Display (void)
         // normal update
         if (!wipe)
         {
+            M_BenchBeginPhase (bench_present);
             I_FinishUpdate ();              // page flip or blit buffer
+            M_BenchEndPhase (bench_present);
             return;
         }
 
@@ -452,17 +471,40 @@ void D_DoomLoop (void)
 
 // SOKOL CHANGE
 void D_DoomFrame(void) {
+    M_BenchBeginFrame ();
+
     // frame syncronous IO operations
     I_StartFrame ();
 
+    PROFILE_BEGIN ("TryRunTics");
     TryRunTics (); // will run at least one tic
+    PROFILE_END ();
 
+    PROFILE_BEGIN ("S_UpdateSounds");
     S_UpdateSounds (players[consoleplayer].mo);// move positional sounds
+    PROFILE_END ();
 
     // Update display, next frame, with current state.
     if (screenvisible)
     {
+        PROFILE_BEGIN ("D_Display");
         D_Display ();
+        PROFILE_END ();
+    }
+
+    M_BenchEndFrame ();
+}
+
+// SOKOL CHANGE
+// Draw a display frame between game tics, without running one. The
+// view is drawn fractionaltic of the way to the next tic. A wipe
+// steps once per tic, so it is left on screen.
+void D_DoomRedraw(void) {
+    if (screenvisible && !wiping)
+    {
+        PROFILE_BEGIN ("D_Display");
+        D_Display ();
+        PROFILE_END ();
     }
 }
 
@@ -881,6 +923,54 @@ static boolean D_AddFile(char *filename)
     return handle != NULL;
 }
 
+// Lump names of the demos given with -playdemo/-timedemo. These must
+// outlive D_DoomMain(), which returns before the demo is played.
+
+#define MAXDEMOS 16
+
+static char demolumpnames[MAXDEMOS][9];
+static int numdemolumps;
+
+static void D_AddDemoFile(char *name)
+{
+    char file[256];
+    char *lumpname;
+
+    if (numdemolumps == MAXDEMOS)
+    {
+        printf("Too many demos, ignoring %s.\n", name);
+        return;
+    }
+
+    lumpname = demolumpnames[numdemolumps++];
+
+    // With Vanilla you have to specify the file without extension,
+    // but make that optional.
+    if (M_StringEndsWith(name, ".lmp"))
+    {
+        M_StringCopy(file, name, sizeof(file));
+    }
+    else
+    {
+        DEH_snprintf(file, sizeof(file), "%s.lmp", name);
+    }
+
+    if (D_AddFile(file))
+    {
+        M_StringCopy(lumpname, lumpinfo[numlumps - 1].name, 9);
+    }
+    else
+    {
+        // If file failed to load, still continue trying to play
+        // the demo in the same way as Vanilla Doom.  This makes
+        // tricks like "-playdemo demo1" possible.
+
+        M_StringCopy(lumpname, name, 9);
+    }
+
+    printf("Playing demo %s.\n", file);
+}
+
 // Copyright message banners
 // Some dehacked mods replace these.  These are only displayed if they are 
 // replaced by dehacked.
@@ -1170,13 +1260,14 @@ void D_DoomMain (void)
 {
     int p;
     char file[256];
-    char demolumpname[9];
 #if ORIGCODE
     int numiwadlumps;
 #endif
 
     I_AtExit(D_Endoom, false);
 
+    M_ProfileInit();
+
     // print banner
 
     I_PrintBanner(PACKAGE_STRING);
@@ -1184,6 +1275,18 @@ void D_DoomMain (void)
     DEH_printf("Z_Init: Init zone memory allocation daemon. \n");
     Z_Init ();
 
+    //!
+    // @category obscure
+    //
+    // Run a microbenchmark of the zone memory allocator and exit.
+    //
+
+    if (M_CheckParm("-zonebench"))
+    {
+        M_BenchZone();
+        I_Quit();
+    }
+
 #ifdef FEATURE_MULTIPLAYER
     //!
     // @category net
@@ -1259,6 +1362,16 @@ void D_DoomMain (void)
 
     respawnparm = M_CheckParm ("-respawn");
 
+    //!
+    // @category game
+    //
+    // Run the thinkers in the order they were spawned, as Vanilla
+    // Doom does, rather than pool by pool. This is always done when
+    // playing back or recording demos and in netgames.
+    //
+
+    vanillathinkers = M_CheckParm ("-vanillathinkers");
+
     //!
     // @vanilla
     //
@@ -1479,12 +1592,13 @@ void D_DoomMain (void)
     if (!p)
     {
         //!
-        // @arg <demo>
+        // @arg <demo> [<demo> ...]
         // @category demo
         // @vanilla
         //
         // Play back the demo named demo.lmp, determining the framerate
-        // of the screen.
+        // of the screen. Further demos are played back and timed one
+        // after another, see -benchreport.
         //
 	p = M_CheckParmWithArgs("-timedemo", 1);
 
@@ -1492,32 +1606,17 @@ void D_DoomMain (void)
 
     if (p)
     {
-        // With Vanilla you have to specify the file without extension,
-        // but make that optional.
-        if (M_StringEndsWith(myargv[p + 1], ".lmp"))
-        {
-            M_StringCopy(file, myargv[p + 1], sizeof(file));
-        }
-        else
-        {
-            DEH_snprintf(file, sizeof(file), "%s.lmp", myargv[p+1]);
-        }
+        D_AddDemoFile(myargv[p + 1]);
 
-        if (D_AddFile(file))
-        {
-            M_StringCopy(demolumpname, lumpinfo[numlumps - 1].name,
-                         sizeof(demolumpname));
-        }
-        else
+        // SOKOL CHANGE: -timedemo takes a list of demos which are timed
+        // one after another
+        if (M_CheckParm("-timedemo") == p)
         {
-            // If file failed to load, still continue trying to play
-            // the demo in the same way as Vanilla Doom.  This makes
-            // tricks like "-playdemo demo1" possible.
-
-            M_StringCopy(demolumpname, myargv[p + 1], sizeof(demolumpname));
+            for (p = p + 2; p < myargc && myargv[p][0] != '-'; ++p)
+            {
+                D_AddDemoFile(myargv[p]);
+            }
         }
-
-        printf("Playing demo %s.\n", file);
     }
 
     I_AtExit((atexit_func_t) G_CheckDemoStatus, true);
@@ -1827,15 +1926,24 @@ void D_DoomMain (void)
     if (p)
     {
 		singledemo = true;              // quit after one demo
-		G_DeferedPlayDemo (demolumpname);
+		G_DeferedPlayDemo (demolumpnames[0]);
 		D_DoomLoop ();  // never returns
+		// SOKOL CHANGE: D_DoomLoop() returns, don't fall through
+		// into D_StartTitle(), which would cancel the demo
+		return;
     }
 
     p = M_CheckParmWithArgs("-timedemo", 1);
     if (p)
     {
-		G_TimeDemo (demolumpname);
+		for (p = 0; p < numdemolumps; ++p)
+		{
+		    G_TimeDemo (demolumpnames[p]);
+		}
 		D_DoomLoop ();  // never returns
+		// SOKOL CHANGE: D_DoomLoop() returns, don't fall through
+		// into D_StartTitle(), which would cancel the demo
+		return;
     }
 
     if (startloadgame >= 0)
@@ -31,10 +31,16 @@
 
 #undef FEATURE_MULTIPLAYER
 
-// Enables sound output
+// Enables sound output (the headless backend has no audio device)
 
-//#undef FEATURE_SOUND
+#ifndef DOOMGENERIC_HEADLESS
 #define FEATURE_SOUND
+#endif
+
+// Enables the scoped profiler ('-profile'), without it the profiling
+// scopes compile to nothing
+
+#define FEATURE_PROFILE
 
 #endif /* #ifndef DOOM_FEATURES_H */
 
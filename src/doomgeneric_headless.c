@@ -0,0 +1,93 @@
+//------------------------------------------------------------------------------
+//  doomgeneric_headless.c
+//
+//  A backend without window, GPU or audio device for benchmarking and
+//  regression testing on headless machines. Unlike the sokol backend it
+//  owns the game loop, and the WAD files are loaded from disk through
+//  the stdc_wad_file class (see w_file.c).
+//
+//  Build with DOOMGENERIC_HEADLESS defined.
+//------------------------------------------------------------------------------
+#define _POSIX_C_SOURCE 200112L // clock_gettime(), nanosleep()
+#include "m_argv.h"
+#include "d_loop.h"
+#include "i_timer.h"
+#include "m_profile.h"
+#include "doomgeneric.h"
+#include <time.h>
+
+void D_DoomMain(void);
+void D_DoomFrame(void);
+void dg_Create();
+
+static struct {
+    uint64_t start_ns;
+} app;
+
+static uint64_t clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+int main(int argc, char* argv[]) {
+    myargc = argc;
+    myargv = argv;
+
+    dg_Create();
+    // D_DoomMain() returns after the setup part of D_DoomLoop()
+    D_DoomMain();
+
+    int last_tic = I_GetTime();
+    while (true) {
+        // -timedemo runs one game tick per frame as fast as possible
+        // (singletics), everything else is paced at 35 Hz
+        if (!singletics) {
+            while (I_GetTime() == last_tic) {
+                DG_SleepMs(1);
+            }
+            last_tic = I_GetTime();
+        }
+        M_ProfileBeginFrame();
+        PROFILE_BEGIN("D_DoomFrame");
+        D_DoomFrame();
+        PROFILE_END();
+        M_ProfileEndFrame();
+    }
+    return 0;
+}
+
+//== DoomGeneric backend callbacks =============================================
+
+void DG_Init(void) {
+    app.start_ns = clock_ns();
+}
+
+void DG_DrawFrame(void) {
+    // nothing to present, I_VideoBuffer is the final image
+}
+
+void DG_SetWindowTitle(const char* title) {
+    (void)title;
+}
+
+int DG_GetKey(int* pressed, unsigned char* doomKey) {
+    // no input devices
+    (void)pressed;
+    (void)doomKey;
+    return 0;
+}
+
+void DG_SleepMs(uint32_t ms) {
+    struct timespec ts = {
+        .tv_sec = ms / 1000,
+        .tv_nsec = (long)(ms % 1000) * 1000000,
+    };
+    nanosleep(&ts, 0);
+}
+
+// milliseconds since DG_Init() from a monotonic clock, this drives
+// I_GetTime() and I_GetTimeMS() and thus the -timedemo timing
+uint32_t DG_GetTicksMs(void) {
+    return (uint32_t)((clock_ns() - app.start_ns) / 1000000);
+}
@@ -11,7 +11,9 @@
 #include "sokol_audio.h"
 #include "sokol_glue.h"
 #include "m_argv.h"
+#include "m_profile.h"
 #include "d_event.h"
+#include "m_fixed.h"
 #include "i_video.h"
 #include "i_sound.h"
 #include "w_wad.h"
@@ -19,6 +21,8 @@
 #include "doomgeneric.h"
 #include "doomkeys.h"
 #include <assert.h>
+#include <stdlib.h> // realloc, free
+#include <string.h> // memcpy
 #include "sokol_shaders.glsl.h"
 
 #define MUS_IMPLEMENTATION
@@ -26,22 +30,33 @@
 #define TSF_IMPLEMENTATION
 #include "tsf.h"
 
-#include <math.h>  // round
-
 // in m_menu.c
 extern boolean menuactive;
+// in r_main.c
+extern fixed_t fractionaltic;
 
 void D_DoomMain(void);
 void D_DoomLoop(void);
 void D_DoomFrame(void);
+void D_DoomRedraw(void);
 void dg_Create();
 
 #define KEY_QUEUE_SIZE (32)
 #define MAXSAMPLECOUNT (2048)
 #define NUM_CHANNELS (8)
 #define MIXBUFFERSIZE (MAXSAMPLECOUNT * 2)
-#define MAX_WAD_SIZE (6 * 1024 * 1024)
-#define MAX_SOUNDFONT_SIZE (2 * 1024 * 1024)
+// initial load buffer sizes, above the shipped doom1.wad and soundfont,
+// the buffers grow if a file doesn't fit
+#define INITIAL_WAD_BUFFER_SIZE (6 * 1024 * 1024)
+#define INITIAL_SOUNDFONT_BUFFER_SIZE (2 * 1024 * 1024)
+// native builds stream files in chunks into the growing load buffer, on
+// the web whole files are fetched because streaming uses HTTP range
+// requests, which don't work on the compressed assets
+#if defined(__EMSCRIPTEN__)
+#define LOAD_CHUNK_SIZE (0)
+#else
+#define LOAD_CHUNK_SIZE (256 * 1024)
+#endif
 
 typedef enum {
     APP_STATE_LOADING,
@@ -71,15 +86,24 @@ typedef enum {
     DATA_STATE_FAILED,
 } data_state_t;
 
+typedef struct {
+    data_state_t state;
+    const char* path;
+    void (*callback)(const sfetch_response_t*);
+    size_t size;        // size of the loaded data
+    size_t buf_size;    // allocated size of buf
+    uint8_t* buf;
+    uint8_t* chunk;     // streamed chunks are loaded here, then appended to buf
+} data_t;
+
 static struct {
     app_state_t state;
-    uint32_t frames_per_tick;   // number of frames per game tick
-    uint32_t frame_tick_counter;
+    double tick_time_ms;        // time since the last game tick
     struct {
         sg_buffer vbuf;
         sg_image pal_img;       // 256x1 palette lookup texture
-        sg_image pix_img;       // 320x200 R8 framebuffer texture
-        sg_image rgba_img;      // 320x200 RGBA8 framebuffer texture
+        sg_image pix_img;       // SCREENWIDTH x SCREENHEIGHT R8 framebuffer texture
+        sg_image rgba_img;      // SCREENWIDTH x SCREENHEIGHT RGBA8 framebuffer texture
         sg_pipeline offscreen_pip;
         sg_pipeline display_pip;
         sg_pass offscreen_pass;
@@ -113,47 +137,89 @@ static struct {
         int leftover;
     } music;
     struct {
-        struct {
-            data_state_t state;
-            size_t size;
-            uint8_t buf[MAX_WAD_SIZE];
-        } wad;
-        struct {
-            data_state_t state;
-            size_t size;
-            uint8_t buf[MAX_SOUNDFONT_SIZE];
-        } sf;
+        data_t wad;
+        data_t sf;
     } data;
 } app;
 
-void wad_fetch_callback(const sfetch_response_t* response) {
-    if (response->fetched) {
-        app.data.wad.size = response->data.size;
-        app.data.wad.state = DATA_STATE_VALID;
-        if (app.data.sf.state == DATA_STATE_VALID) {
-            app.state = APP_STATE_WAITING;
-        }
+// (re-)start loading a file into a heap buffer of data->buf_size bytes,
+// whole or in chunks
+static void fetch_data(data_t* data) {
+    data->buf = realloc(data->buf, data->buf_size);
+    assert(data->buf);
+    if (LOAD_CHUNK_SIZE > 0) {
+        data->chunk = realloc(data->chunk, LOAD_CHUNK_SIZE);
+        assert(data->chunk);
+        sfetch_send(&(sfetch_request_t){
+            .path = data->path,
+            .callback = data->callback,
+            .chunk_size = LOAD_CHUNK_SIZE,
+            .buffer = { .ptr = data->chunk, .size = LOAD_CHUNK_SIZE },
+        });
     }
-    else if (response->failed) {
-        app.state = APP_STATE_LOADING_FAILED;
-        app.data.wad.state = DATA_STATE_FAILED;
+    else {
+        sfetch_send(&(sfetch_request_t){
+            .path = data->path,
+            .callback = data->callback,
+            .buffer = { .ptr = data->buf, .size = data->buf_size },
+        });
     }
 }
 
-void sf_fetch_callback(const sfetch_response_t* response) {
+// common part of the fetch callbacks, streamed chunks are appended to the
+// load buffer which grows as needed, whole files which don't fit into it
+// are fetched again with a bigger buffer, so that memory use follows the
+// actual file size without knowing it upfront
+static void handle_fetch_response(data_t* data, const sfetch_response_t* response) {
     if (response->fetched) {
-        app.data.sf.size = response->data.size;
-        app.data.sf.state = DATA_STATE_VALID;
-        if (app.data.wad.state == DATA_STATE_VALID) {
+        const size_t end = response->data_offset + response->data.size;
+        if (response->data.ptr != data->buf) {
+            if (end > data->buf_size) {
+                while (end > data->buf_size) {
+                    data->buf_size *= 2;
+                }
+                data->buf = realloc(data->buf, data->buf_size);
+                assert(data->buf);
+            }
+            memcpy(data->buf + response->data_offset, response->data.ptr, response->data.size);
+        }
+        data->size = end;
+        if (!response->finished) {
+            return;
+        }
+        free(data->chunk);
+        data->chunk = 0;
+        // give back the unused part of the load buffer
+        data->buf = realloc(data->buf, data->size);
+        data->buf_size = data->size;
+        assert(data->buf);
+        data->state = DATA_STATE_VALID;
+        if ((app.data.wad.state == DATA_STATE_VALID) && (app.data.sf.state == DATA_STATE_VALID)) {
             app.state = APP_STATE_WAITING;
         }
     }
     else if (response->failed) {
-        app.state = APP_STATE_LOADING_FAILED;
-        app.data.sf.state = DATA_STATE_FAILED;
+        free(data->chunk);
+        data->chunk = 0;
+        if (response->error_code == SFETCH_ERROR_BUFFER_TOO_SMALL) {
+            data->buf_size *= 2;
+            fetch_data(data);
+        }
+        else {
+            app.state = APP_STATE_LOADING_FAILED;
+            data->state = DATA_STATE_FAILED;
+        }
     }
 }
 
+void wad_fetch_callback(const sfetch_response_t* response) {
+    handle_fetch_response(&app.data.wad, response);
+}
+
+void sf_fetch_callback(const sfetch_response_t* response) {
+    handle_fetch_response(&app.data.sf, response);
+}
+
 void init(void) {
     // initialize sokol-time, -gfx, -debugtext and -fetch
     sg_setup(&(sg_desc){
@@ -169,7 +235,8 @@ void init(void) {
         .fonts[0] = sdtx_font_kc854(),
     });
     sfetch_setup(&(sfetch_desc_t){
-        .max_requests = 2,
+        // one extra request per file for retrying with a bigger buffer
+        .max_requests = 4,
         .num_channels = 1,
         .num_lanes = 2,
     });
@@ -190,18 +257,6 @@ void init(void) {
         .data = SG_RANGE(verts),
     });
 
-    // a dynamic texture for Doom's framebuffer
-    app.gfx.pix_img = sg_make_image(&(sg_image_desc){
-        .width = SCREENWIDTH,
-        .height = SCREENHEIGHT,
-        .pixel_format = SG_PIXELFORMAT_R8,
-        .usage = SG_USAGE_STREAM,
-        .min_filter = SG_FILTER_NEAREST,
-        .mag_filter = SG_FILTER_NEAREST,
-        .wrap_u = SG_WRAP_CLAMP_TO_EDGE,
-        .wrap_v = SG_WRAP_CLAMP_TO_EDGE,
-    });
-
     // another dynamic texture for the color palette
     app.gfx.pal_img = sg_make_image(&(sg_image_desc){
         .width = 256,
@@ -214,20 +269,6 @@ void init(void) {
         .wrap_v = SG_WRAP_CLAMP_TO_EDGE,
     });
 
-    // an RGBA8 texture to hold the 'color palette expanded' image
-    // and source for upscaling with linear filtering
-    app.gfx.rgba_img = sg_make_image(&(sg_image_desc){
-        .render_target = true,
-        .width = SCREENWIDTH,
-        .height = SCREENHEIGHT,
-        .pixel_format = SG_PIXELFORMAT_RGBA8,
-        .usage = SG_USAGE_IMMUTABLE,
-        .min_filter = SG_FILTER_LINEAR,
-        .mag_filter = SG_FILTER_LINEAR,
-        .wrap_u = SG_WRAP_CLAMP_TO_EDGE,
-        .wrap_v = SG_WRAP_CLAMP_TO_EDGE,
-    });
-
     // a pipeline object for the offscreen render pass which
     // performs the color palette lookup
     app.gfx.offscreen_pip = sg_make_pipeline(&(sg_pipeline_desc){
@@ -258,26 +299,53 @@ void init(void) {
         },
     });
 
-    // a render pass object for the offscreen pass
-    app.gfx.offscreen_pass = sg_make_pass(&(sg_pass_desc){
-        .color_attachments[0].image = app.gfx.rgba_img,
-    });
-
     // start loading the DOOM1.WAD and soundfont files, the game start will be delayed
     // until loading has finished (see the frame() callback below)
     // NOTE: those files have .wasm extension only so that they are compressed
     // by web servers, they are not actually WASM files!
-    sfetch_send(&(sfetch_request_t){
-        .path = "doom1.wad.wasm",
-        .callback = wad_fetch_callback,
-        .buffer = SFETCH_RANGE(app.data.wad.buf),
+    app.data.wad.path = "doom1.wad.wasm";
+    app.data.wad.callback = wad_fetch_callback;
+    app.data.wad.buf_size = INITIAL_WAD_BUFFER_SIZE;
+    fetch_data(&app.data.wad);
+    app.data.sf.path = "aweromgm.sf2.wasm";
+    app.data.sf.callback = sf_fetch_callback;
+    app.data.sf.buf_size = INITIAL_SOUNDFONT_BUFFER_SIZE;
+    fetch_data(&app.data.sf);
+    app.state = APP_STATE_LOADING;
+}
+
+// create the framebuffer textures once the render resolution is known
+static void create_framebuffer(void) {
+    // a dynamic texture for Doom's framebuffer
+    app.gfx.pix_img = sg_make_image(&(sg_image_desc){
+        .width = SCREENWIDTH,
+        .height = SCREENHEIGHT,
+        .pixel_format = SG_PIXELFORMAT_R8,
+        .usage = SG_USAGE_STREAM,
+        .min_filter = SG_FILTER_NEAREST,
+        .mag_filter = SG_FILTER_NEAREST,
+        .wrap_u = SG_WRAP_CLAMP_TO_EDGE,
+        .wrap_v = SG_WRAP_CLAMP_TO_EDGE,
     });
-    sfetch_send(&(sfetch_request_t){
-        .path = "aweromgm.sf2.wasm",
-        .callback = sf_fetch_callback,
-        .buffer = SFETCH_RANGE(app.data.sf.buf),
+
+    // an RGBA8 texture to hold the 'color palette expanded' image
+    // and source for upscaling with linear filtering
+    app.gfx.rgba_img = sg_make_image(&(sg_image_desc){
+        .render_target = true,
+        .width = SCREENWIDTH,
+        .height = SCREENHEIGHT,
+        .pixel_format = SG_PIXELFORMAT_RGBA8,
+        .usage = SG_USAGE_IMMUTABLE,
+        .min_filter = SG_FILTER_LINEAR,
+        .mag_filter = SG_FILTER_LINEAR,
+        .wrap_u = SG_WRAP_CLAMP_TO_EDGE,
+        .wrap_v = SG_WRAP_CLAMP_TO_EDGE,
+    });
+
+    // a render pass object for the offscreen pass
+    app.gfx.offscreen_pass = sg_make_pass(&(sg_pass_desc){
+        .color_attachments[0].image = app.gfx.rgba_img,
     });
-    app.state = APP_STATE_LOADING;
 }
 
 static void draw_loading_msg(const char* name, data_state_t data_state) {
@@ -422,8 +490,12 @@ static void update_game_audio() {
     const int num_frames = saudio_expect();
     if (num_frames > 0) {
         assert(num_frames <= MAXSAMPLECOUNT);
+        PROFILE_BEGIN("snd_mix");
         snd_mix(num_frames);
+        PROFILE_END();
+        PROFILE_BEGIN("mus_mix");
         mus_mix(num_frames);
+        PROFILE_END();
         saudio_push(app.sound.mixbuffer, num_frames);
     }
 }
@@ -431,15 +503,12 @@ static void update_game_audio() {
 void frame(void) {
     sfetch_dowork();
 
-    // compute frames-per-tick to get us close to the ideal 35 Hz game tick
-    // but without skipping ticks
     double frame_time_ms = sapp_frame_duration() * 1000.0;
     if (frame_time_ms > 40.0) {
         // prevent overly long frames (for instance when in debugger)
         frame_time_ms = 40.0;
     }
     const double tick_time_ms = 1000.0 / 35.0;
-    app.frames_per_tick = (uint32_t) round(tick_time_ms / frame_time_ms);
 
     switch (app.state) {
         case APP_STATE_LOADING:
@@ -449,14 +518,36 @@ void frame(void) {
             break;
         case APP_STATE_INIT:
             dg_Create();
+            // render at the largest multiple of 320x200 that fits the
+            // framebuffer height, -hires overrides this in V_Init()
+            I_SetScreenScale(sapp_height() / ORIGHEIGHT);
+            // and widen it to the framebuffer aspect ratio, -aspect
+            // overrides this in V_Init() too
+            I_SetScreenAspect(sapp_width(), sapp_height());
             // D_DoomMain() without the trailing call to D_DoomLoop()
             D_DoomMain();
+            create_framebuffer();
             app.state = APP_STATE_RUNNING;
             // fallthough!
         case APP_STATE_RUNNING:
-            if (++app.frame_tick_counter >= app.frames_per_tick) {
-                app.frame_tick_counter = 0;
+            M_ProfileBeginFrame();
+            // run the game at 35 Hz but render every frame, the frames
+            // between game ticks are drawn between the last two ticks,
+            // at most one tick runs per frame, so the game slows down
+            // instead of skipping ticks on displays below 35 Hz
+            app.tick_time_ms += frame_time_ms;
+            const bool run_tick = app.tick_time_ms >= tick_time_ms;
+            if (run_tick) {
+                app.tick_time_ms -= tick_time_ms;
+                if (app.tick_time_ms > tick_time_ms) {
+                    app.tick_time_ms = tick_time_ms;
+                }
+            }
+            fractionaltic = (fixed_t) (app.tick_time_ms / tick_time_ms * FRACUNIT);
+            if (run_tick) {
+                PROFILE_BEGIN("D_DoomFrame");
                 D_DoomFrame();
+                PROFILE_END();
                 // this prevents that very short mouse button taps on touchpads are not deteced
                 if (app.inp.delayed_mouse_button_up != 0) {
                     app.inp.mouse_button_state &= ~app.inp.delayed_mouse_button_up;
@@ -467,8 +558,16 @@ void frame(void) {
                     });
                 }
             }
+            else {
+                PROFILE_BEGIN("D_DoomRedraw");
+                D_DoomRedraw();
+                PROFILE_END();
+            }
             update_game_audio();
+            PROFILE_BEGIN("draw_game_frame");
             draw_game_frame();
+            PROFILE_END();
+            M_ProfileEndFrame();
             break;
     }
 }
@@ -687,8 +786,8 @@ sapp_desc sokol_main(int argc, char* argv[]) {
         .frame_cb = frame,
         .cleanup_cb = cleanup,
         .event_cb = input,
-        .width = SCREENWIDTH * 3,
-        .height = SCREENHEIGHT * 3,
+        .width = ORIGWIDTH * 3,
+        .height = ORIGHEIGHT * 3,
         .window_title = "Doom (shareware) on Sokol",
         .icon.sokol_default = true,
     };
@@ -703,6 +802,9 @@ void DG_Init(void) {
     // initialize sound font
     assert(app.data.sf.size > 0);
     app.music.sound_font = tsf_load_memory(app.data.sf.buf, app.data.sf.size);
+    // TinySoundFont has copied what it needs, the file data is no longer needed
+    free(app.data.sf.buf);
+    app.data.sf.buf = 0;
     tsf_set_output(app.music.sound_font, TSF_STEREO_INTERLEAVED, saudio_sample_rate(), 0);
 }
 
@@ -770,7 +872,10 @@ static wad_file_t* memio_OpenFile(char* path) {
 
     memio_wad_file_t* result = Z_Malloc(sizeof(memio_wad_file_t), PU_STATIC, 0);
     result->wad.file_class = &memio_wad_file;
-    result->wad.mapped = NULL;
+    // the WAD is already in memory, expose it as mapped region so that
+    // W_CacheLumpNum() returns pointers into the buffer instead of copying
+    // every lump into the zone (memio_Read() is only used by W_ReadLump())
+    result->wad.mapped = app.data.wad.buf;
     result->wad.length = app.data.wad.size;
     result->fstream = fstream;
 
@@ -46,6 +46,7 @@
 extern  boolean	nomonsters;	// checkparm of -nomonsters
 extern  boolean	respawnparm;	// checkparm of -respawn
 extern  boolean	fastparm;	// checkparm of -fast
+extern  boolean	vanillathinkers;	// checkparm of -vanillathinkers
 
 extern  boolean	devparm;	// DEBUG: launched with -devparm
 
@@ -52,6 +52,14 @@
 #define PACKEDATTR
 #endif
 
+// SOKOL CHANGE: state which every render thread needs its own copy of.
+
+#if defined(_MSC_VER)
+#define THREADLOCAL __declspec(thread)
+#else
+#define THREADLOCAL __thread
+#endif
+
 // C99 integer types; with gcc we just use this.  Other compilers 
 // should add conditional statements that define the C99 types.
 
@@ -149,7 +149,7 @@ wipe_initMelt
     // (y<0 => not ready to scroll yet)
     y = (int *) Z_Malloc(width*sizeof(int), PU_STATIC, 0);
     y[0] = -(M_Random()%16);
-    for (i=1;i<width;i++)
+    for (i=1;i<width/screenscale;i++)
     {
 	r = (M_Random()%3) - 1;
 	y[i] = y[i-1] + r;
@@ -157,6 +157,13 @@ wipe_initMelt
 	else if (y[i] == -16) y[i] = -15;
     }
 
+    // SOKOL CHANGE: melt the same columns as at 320x200, scaled up
+    if (screenscale > 1)
+    {
+	for (i=width-1;i>=0;i--)
+	    y[i] = y[i/screenscale]*screenscale;
+    }
+
     return 0;
 }
 
@@ -183,11 +190,11 @@ wipe_doMelt
 	{
 	    if (y[i]<0)
 	    {
-		y[i]++; done = false;
+		y[i] += screenscale; done = false;
 	    }
 	    else if (y[i] < height)
 	    {
-		dy = (y[i] < 16) ? y[i]+1 : 8;
+		dy = (y[i] < 16*screenscale) ? y[i]+screenscale : 8*screenscale;
 		if (y[i]+dy >= height) dy = height - y[i];
 		s = &((short *)wipe_scr_end)[i*height+y[i]];
 		d = &((short *)wipe_scr)[y[i]*width+i];
@@ -31,6 +31,7 @@
 #include "z_zone.h"
 #include "f_finale.h"
 #include "m_argv.h"
+#include "m_bench.h"
 #include "m_controls.h"
 #include "m_misc.h"
 #include "m_menu.h"
@@ -112,6 +113,12 @@ boolean         usergame;               // ok to save / end game
 boolean         timingdemo;             // if true, exit with report on completion 
 boolean         nodrawers;              // for comparative timing purposes 
 int             starttime;          	// for comparative timing purposes  	 
+
+// Demos queued by G_TimeDemo, timed one after another.
+static char     **timedemos;
+static int      numtimedemos;
+static int      nexttimedemo;
+static int      demostarttic;
  
 boolean         viewactive; 
  
@@ -1005,7 +1012,9 @@ void G_Ticker (void)
     switch (gamestate) 
     { 
       case GS_LEVEL: 
+	M_BenchBeginPhase (bench_sim);
 	P_Ticker (); 
+	M_BenchEndPhase (bench_sim);
 	ST_Ticker (); 
 	AM_Ticker (); 
 	HU_Ticker ();            
@@ -2212,7 +2221,18 @@ void G_DoPlayDemo (void)
     precache = false;
     G_InitNew (skill, episode, map); 
     precache = true; 
-    starttime = I_GetTime (); 
+
+    // Time all queued demos from the start of the first one
+    if (!timingdemo || nexttimedemo == 1)
+    {
+        starttime = I_GetTime ();
+    }
+
+    if (timingdemo)
+    {
+        demostarttic = gametic;
+        M_BenchStartDemo (defdemoname);
+    }
 
     usergame = false; 
     demoplayback = true; 
@@ -2234,8 +2254,21 @@ void G_TimeDemo (char* name)
     timingdemo = true; 
     singletics = true; 
 
-    defdemoname = name; 
-    gameaction = ga_playdemo; 
+    timedemos = realloc(timedemos, (numtimedemos + 1) * sizeof(*timedemos));
+
+    if (timedemos == NULL)
+    {
+        I_Error ("Couldn't realloc timedemos");
+    }
+
+    timedemos[numtimedemos++] = name;
+
+    // Further calls only add to the queue
+    if (numtimedemos == 1)
+    {
+        defdemoname = timedemos[nexttimedemo++];
+        gameaction = ga_playdemo;
+    }
 } 
  
  
@@ -2252,12 +2285,21 @@ void G_TimeDemo (char* name)
 boolean G_CheckDemoStatus (void) 
 { 
     int             endtime; 
+    boolean         nexttiming = false;
 	 
-    if (timingdemo) 
+    if (timingdemo && nexttimedemo < numtimedemos)
+    {
+        // Play the next queued demo once this one is cleaned up
+        M_BenchEndDemo (gametic - demostarttic);
+        nexttiming = true;
+    }
+    else if (timingdemo) 
     { 
         float fps;
         int realtics;
 
+        M_BenchEndDemo (gametic - demostarttic);
+
 	endtime = I_GetTime (); 
         realtics = endtime - starttime;
         fps = ((float) gametic * TICRATE) / realtics;
@@ -2266,6 +2308,13 @@ boolean G_CheckDemoStatus (void)
         timingdemo = false;
         demoplayback = false;
 
+        if (M_BenchWriteReport ())
+        {
+            printf ("timed %i gametics in %i realtics (%f fps)\n",
+                    gametic, realtics, fps);
+            I_Quit ();
+        }
+
 	I_Error ("timed %i gametics in %i realtics (%f fps)",
                  gametic, realtics, fps);
     } 
@@ -2282,6 +2331,13 @@ boolean G_CheckDemoStatus (void)
 	fastparm = false;
 	nomonsters = false;
 	consoleplayer = 0;
+
+        if (nexttiming)
+        {
+            defdemoname = timedemos[nexttimedemo++];
+            gameaction = ga_playdemo;
+            return true;
+        }
         
         if (singledemo) 
             I_Quit (); 
@@ -130,10 +130,17 @@ static byte *AutoAllocMemory(int *size, int default_ram, int min_ram)
     return zonemem;
 }
 
+// Size of the zone regions, total size, and the -maxmb limit
+
+static int zone_growsize;
+static size_t zone_total;
+static size_t zone_limit;
+
 byte *I_ZoneBase (int *size)
 {
     byte *zonemem;
     int min_ram, default_ram;
+    int max_ram;
     int p;
 
     //!
@@ -160,6 +167,70 @@ byte *I_ZoneBase (int *size)
     printf("zone memory: %p, %x allocated for zone\n", 
            zonemem, *size);
 
+    //!
+    // @arg <mb>
+    //
+    // Limit the total heap size, in MiB. The heap grows beyond its
+    // initial size (see -mb) when it runs out of memory, up to this
+    // limit (default no limit).
+    //
+
+    p = M_CheckParmWithArgs("-maxmb", 1);
+
+    if (p > 0)
+    {
+        max_ram = atoi(myargv[p+1]);
+
+        if (max_ram > 0)
+        {
+            zone_limit = (size_t) max_ram << 20;
+        }
+    }
+
+    zone_growsize = *size;
+    zone_total = *size;
+
+    return zonemem;
+}
+
+// SOKOL CHANGE: allocate another region for the zone of at least
+// min_size bytes. Regions are as big as the initial zone unless
+// more is needed, returns NULL if that would exceed -maxmb.
+
+byte *I_ZoneGrow (int min_size, int *size)
+{
+    byte *zonemem;
+
+    *size = zone_growsize;
+
+    if (*size < min_size)
+    {
+        // round up to whole MiB
+        *size = (min_size + 0xfffff) & ~0xfffff;
+    }
+
+    if (zone_limit > 0 && zone_total + (size_t) *size > zone_limit)
+    {
+        if (zone_total + (size_t) min_size > zone_limit)
+        {
+            return NULL;
+        }
+
+        *size = zone_limit - zone_total;
+    }
+
+    zonemem = malloc(*size);
+
+    if (zonemem == NULL)
+    {
+        return NULL;
+    }
+
+    zone_total += *size;
+
+    printf("zone memory: %p, %x added to zone, %i KiB total\n",
+           zonemem, *size, (int) (zone_total / 1024));
+
     return zonemem;
 }
 
@@ -260,6 +331,8 @@ void I_Quit (void)
 #if ORIGCODE
     SDL_Quit();
 
+    exit(0);
+#elif defined(DOOMGENERIC_HEADLESS)
     exit(0);
 #endif
 }
@@ -403,7 +476,11 @@ void I_Error (char *error, ...)
         entry = entry->next;
     }
 
+#ifdef DOOMGENERIC_HEADLESS
+    exit_gui_popup = false;
+#else
     exit_gui_popup = !M_ParmExists("-nogui");
+#endif
 
     // Pop up a GUI dialog box to show the error message, if the
     // game was not run from the console (and the user will
@@ -458,6 +535,8 @@ void I_Error (char *error, ...)
 #if ORIGCODE
     SDL_Quit();
 
+    exit(-1);
+#elif defined(DOOMGENERIC_HEADLESS)
     exit(-1);
 #else
     while (true)
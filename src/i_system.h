@@ -34,6 +34,10 @@ void I_Init (void);
 // for the zone management.
 byte*	I_ZoneBase (int *size);
 
+// Called by the zone when it runs out of memory, returns
+// NULL if no more memory may be used.
+byte*	I_ZoneGrow (int min_size, int *size);
+
 boolean I_ConsoleStdout(void);
 
 
@@ -0,0 +1,178 @@
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//      System-specific worker threads.
+//
+
+#include "config.h"
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#include "i_thread.h"
+
+#ifdef HAVE_PTHREAD
+
+#define MAXTHREADS 64
+
+static int numthreads = 1;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wakeup = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t finished = PTHREAD_COND_INITIALIZER;
+
+// The current batch of jobs, protected by lock. Every call of
+// I_RunThreads is a new generation, which wakes up the workers.
+
+static void (*jobfunc)(int job);
+static int numjobs;
+static int nextjob;
+static int busythreads;
+static unsigned int generation;
+
+// Take jobs until there are none left, called with the lock held.
+
+static void RunJobs(void)
+{
+    int job;
+
+    while (nextjob < numjobs)
+    {
+        job = nextjob++;
+
+        pthread_mutex_unlock(&lock);
+        jobfunc(job);
+        pthread_mutex_lock(&lock);
+    }
+}
+
+static void *WorkerThread(void *arg)
+{
+    unsigned int seen = 0;
+
+    pthread_mutex_lock(&lock);
+
+    for (;;)
+    {
+        while (generation == seen)
+        {
+            pthread_cond_wait(&wakeup, &lock);
+        }
+
+        seen = generation;
+
+        RunJobs();
+
+        if (--busythreads == 0)
+        {
+            pthread_cond_signal(&finished);
+        }
+    }
+
+    return NULL;
+}
+
+int I_InitThreads(int count)
+{
+    pthread_attr_t attr;
+    pthread_t thread;
+
+    if (count > MAXTHREADS)
+    {
+        count = MAXTHREADS;
+    }
+
+    // The workers run until exit, they are never joined.
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+    while (numthreads < count)
+    {
+        if (pthread_create(&thread, &attr, WorkerThread, NULL) != 0)
+        {
+            break;
+        }
+
+        ++numthreads;
+    }
+
+    pthread_attr_destroy(&attr);
+
+    return numthreads;
+}
+
+void I_RunThreads(void (*func)(int job), int count)
+{
+    pthread_mutex_lock(&lock);
+
+    jobfunc = func;
+    numjobs = count;
+    nextjob = 0;
+
+    // The workers count themselves out when they are done, this
+    // thread is the last one.
+
+    busythreads = numthreads;
+    ++generation;
+    pthread_cond_broadcast(&wakeup);
+
+    RunJobs();
+
+    --busythreads;
+
+    while (busythreads > 0)
+    {
+        pthread_cond_wait(&finished, &lock);
+    }
+
+    pthread_mutex_unlock(&lock);
+}
+
+int I_NumCPUs(void)
+{
+    long result;
+
+    result = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return result > 0 ? result : 1;
+}
+
+#else
+
+int I_InitThreads(int count)
+{
+    return 1;
+}
+
+void I_RunThreads(void (*func)(int job), int count)
+{
+    int i;
+
+    for (i = 0; i < count; ++i)
+    {
+        func(i);
+    }
+}
+
+int I_NumCPUs(void)
+{
+    return 1;
+}
+
+#endif
+
@@ -0,0 +1,36 @@
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//      System-specific worker threads.
+//
+
+
+#ifndef __I_THREAD__
+#define __I_THREAD__
+
+// Start up to numthreads-1 worker threads, the calling thread is the
+// last one. Returns the number of threads which will run jobs, this
+// is 1 on platforms without threads.
+int I_InitThreads(int numthreads);
+
+// Run func(0) to func(count-1) on all threads, jobs are handed out
+// in order as threads become free. Returns when all jobs are done.
+void I_RunThreads(void (*func)(int job), int count);
+
+// Number of processors, 1 if unknown.
+int I_NumCPUs(void);
+
+#endif
+
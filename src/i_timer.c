@@ -25,6 +25,13 @@
 //#include <sys/time.h>
 //#include <unistd.h>
 
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
 
 //
 // I_GetTime
@@ -70,6 +77,33 @@ int I_GetTimeMS(void)
     return ticks - basetime;
 }
 
+//
+// Same as I_GetTimeMS, but from the OS's high resolution clock and
+// in microseconds
+//
+
+uint64_t I_GetTimeUS(void)
+{
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER now;
+
+    if (freq.QuadPart == 0)
+        QueryPerformanceFrequency(&freq);
+
+    QueryPerformanceCounter(&now);
+
+    return (uint64_t) (now.QuadPart / freq.QuadPart) * 1000000
+         + (uint64_t) (now.QuadPart % freq.QuadPart) * 1000000 / freq.QuadPart;
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
 // Sleep for a specified number of ms
 
 void I_Sleep(int ms)
@@ -40,6 +40,7 @@ rcsid[] = "$Id: i_x.c,v 1.6 1997/02/03 22:45:10 b1 Exp $";
 
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <fcntl.h>
 
@@ -92,6 +93,17 @@ void I_GetEvent(void);
 
 byte *I_VideoBuffer = NULL;
 
+// SOKOL CHANGE: the render resolution
+
+int SCREENWIDTH = ORIGWIDTH;
+int SCREENHEIGHT = ORIGHEIGHT;
+int screenscale = 1;
+int widescreendelta = 0;
+
+// screen width in 320x200 units
+
+static int screenunits = ORIGWIDTH;
+
 // If true, game is running as a screensaver
 
 boolean screensaver_mode = false;
@@ -227,6 +239,10 @@ void I_InitGraphics (void)
     /* Allocate screen to draw to */
 	I_VideoBuffer = (byte*)Z_Malloc (SCREENWIDTH * SCREENHEIGHT, PU_STATIC, NULL);  // For DOOM to draw on
 
+	// SOKOL CHANGE: the first wipe starts from it, and the zone
+	//  has been used for loading a level by now.
+	memset (I_VideoBuffer, 0, SCREENWIDTH * SCREENHEIGHT);
+
 	screenvisible = true;
 
     extern void I_InitInput(void);
@@ -297,9 +313,11 @@ void I_FinishUpdate (void)
         }
         line_in += SCREENWIDTH;
     }
+*/
 
+    // SOKOL CHANGE: the sokol backend presents I_VideoBuffer in its
+    // frame callback, DG_DrawFrame() is only a hook for other backends
 	DG_DrawFrame();
-*/
 }
 
 //
@@ -405,6 +423,45 @@ void I_GraphicsCheckCommandLine (void)
 {
 }
 
+static void SetScreenSize (void)
+{
+    SCREENWIDTH = screenunits * screenscale;
+    SCREENHEIGHT = ORIGHEIGHT * screenscale;
+    widescreendelta = (screenunits - ORIGWIDTH) / 2;
+}
+
+void I_SetScreenScale (int scale)
+{
+    if (scale < 1)
+        scale = 1;
+    if (scale > MAXSCREENSCALE)
+        scale = MAXSCREENSCALE;
+
+    screenscale = scale;
+    SetScreenSize();
+}
+
+void I_SetScreenAspect (int width, int height)
+{
+    int units;
+
+    if (width <= 0 || height <= 0)
+        return;
+
+    // Even, so that the 2D graphics are centered on whole units.
+    // Narrower than 16:10 is letterboxed as before.
+
+    units = (int) ((int64_t) ORIGHEIGHT * width / height) & ~1;
+
+    if (units < ORIGWIDTH)
+        units = ORIGWIDTH;
+    if (units > MAXWIDEWIDTH)
+        units = MAXWIDEWIDTH;
+
+    screenunits = units;
+    SetScreenSize();
+}
+
 void I_SetGrabMouseCallback (grabmouse_callback_t func)
 {
 }
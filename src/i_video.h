@@ -22,10 +22,29 @@
 
 #include "doomtype.h"
 
-// Screen width and height.
+// SOKOL CHANGE: the render resolution is chosen at startup. The 2D
+// graphics (status bar, menus, intermission and finale screens) are
+// made for ORIGWIDTH x ORIGHEIGHT and are scaled up by screenscale.
 
-#define SCREENWIDTH  320
-#define SCREENHEIGHT 200
+#define ORIGWIDTH  320
+#define ORIGHEIGHT 200
+
+// Up to 1920x1200.
+
+#define MAXSCREENSCALE 6
+
+// Widescreen: the screen can be up to twice as wide as ORIGWIDTH, in
+// 320x200 units, with the 2D graphics centered.
+
+#define MAXWIDEWIDTH (ORIGWIDTH * 2)
+
+// Screen width and height, screenscale times the screen size in 320x200
+// units. The width is ORIGWIDTH plus twice widescreendelta.
+
+extern int SCREENWIDTH;
+extern int SCREENHEIGHT;
+extern int screenscale;
+extern int widescreendelta;
 
 // Screen width used for "squash" scale functions
 
@@ -98,6 +117,14 @@ void I_InitGraphics (void);
 
 void I_GraphicsCheckCommandLine(void);
 
+// SOKOL CHANGE: sets the render resolution to screenscale times
+// 320x200, must be called before V_Init().
+void I_SetScreenScale(int scale);
+
+// SOKOL CHANGE: widens the screen to the given aspect ratio (with
+// square pixels, 320x200 is 16:10), must be called before V_Init().
+void I_SetScreenAspect(int width, int height);
+
 void I_ShutdownGraphics(void);
 
 // Takes full 8 bit values.
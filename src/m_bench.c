@@ -0,0 +1,610 @@
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//      Timedemo benchmark: per-tic timing of the simulation, rendering
+//      and presentation phases, written to a JSON or CSV report.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "doomtype.h"
+#include "i_system.h"
+#include "i_timer.h"
+#include "m_argv.h"
+#include "m_misc.h"
+#include "r_main.h"
+#include "r_prelit.h"
+#include "z_zone.h"
+
+#include "m_bench.h"
+
+// Upper bounds of the frame time histogram buckets in microseconds,
+// the last bucket collects all slower frames.
+
+static const uint32_t histogram_bounds[] =
+{
+    125, 250, 500, 1000, 2000, 4000, 8000, 16000, 32000, 64000,
+};
+
+#define NUMBUCKETS (arrlen(histogram_bounds) + 1)
+
+static const char *phase_names[NUMBENCHPHASES] =
+{
+    "sim", "render", "present",
+};
+
+typedef struct
+{
+    uint32_t frame_us;
+    uint32_t phase_us[NUMBENCHPHASES];
+} benchtic_t;
+
+typedef struct
+{
+    char name[9];
+    int gametics;
+    uint64_t realtime_us;
+    benchtic_t *tics;
+    int numtics;
+    int maxtics;
+    highwater_t highwater;      // renderer arrays
+    prelitstats_t prelit;       // prelit cache lookups
+} benchdemo_t;
+
+typedef struct
+{
+    double min, mean, p50, p95, p99, max;
+} benchstats_t;
+
+static benchdemo_t *demos;
+static int numdemos;
+
+static boolean recording;       // inside a timed demo
+static boolean frameactive;     // current frame started while recording
+static uint64_t demostart;
+static uint64_t framestart;
+static uint64_t phasestart[NUMBENCHPHASES];
+static uint32_t phasetime[NUMBENCHPHASES];
+
+static void *GrowArray(void *ptr, size_t size)
+{
+    void *newptr;
+
+    newptr = realloc(ptr, size);
+
+    if (newptr == NULL)
+    {
+        I_Error("M_Bench: failed to allocate %i bytes", (int) size);
+    }
+
+    return newptr;
+}
+
+void M_BenchStartDemo(char *name)
+{
+    benchdemo_t *demo;
+
+    demos = GrowArray(demos, (numdemos + 1) * sizeof(*demos));
+    demo = &demos[numdemos++];
+    memset(demo, 0, sizeof(*demo));
+    M_StringCopy(demo->name, name, sizeof(demo->name));
+
+    // The demo is started from within G_Ticker(), so the first frame
+    // only covers the rest of that frame.
+
+    recording = true;
+    frameactive = true;
+    demostart = framestart = I_GetTimeUS();
+    memset(phasetime, 0, sizeof(phasetime));
+    memset(&highwater, 0, sizeof(highwater));
+    memset(&prelitstats, 0, sizeof(prelitstats));
+}
+
+static int CompareUInt(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *) a;
+    uint32_t y = *(const uint32_t *) b;
+
+    return (x > y) - (x < y);
+}
+
+// Statistics of one column of the per-tic records, in milliseconds.
+// Percentiles use the nearest rank method.
+
+static benchstats_t ComputeStats(benchdemo_t *demo, int phase)
+{
+    benchstats_t stats;
+    uint32_t *values;
+    uint64_t sum;
+    int n, i;
+
+    memset(&stats, 0, sizeof(stats));
+    n = demo->numtics;
+
+    if (n == 0)
+    {
+        return stats;
+    }
+
+    values = malloc(n * sizeof(*values));
+    sum = 0;
+
+    for (i = 0; i < n; ++i)
+    {
+        values[i] = phase < 0 ? demo->tics[i].frame_us
+                              : demo->tics[i].phase_us[phase];
+        sum += values[i];
+    }
+
+    qsort(values, n, sizeof(*values), CompareUInt);
+
+    stats.min = values[0] / 1000.0;
+    stats.max = values[n - 1] / 1000.0;
+    stats.mean = (double) sum / n / 1000.0;
+    stats.p50 = values[(n * 50 + 99) / 100 - 1] / 1000.0;
+    stats.p95 = values[(n * 95 + 99) / 100 - 1] / 1000.0;
+    stats.p99 = values[(n * 99 + 99) / 100 - 1] / 1000.0;
+
+    free(values);
+
+    return stats;
+}
+
+static double TicsPerSecond(benchdemo_t *demo)
+{
+    if (demo->realtime_us == 0)
+    {
+        return 0.0;
+    }
+
+    return demo->gametics * 1000000.0 / demo->realtime_us;
+}
+
+// Share of the prelit cache lookups that found the texture lit.
+
+static double PrelitHitRate(benchdemo_t *demo)
+{
+    int lookups = demo->prelit.hits + demo->prelit.misses;
+
+    if (lookups == 0)
+    {
+        return 0.0;
+    }
+
+    return (double) demo->prelit.hits / lookups;
+}
+
+void M_BenchEndDemo(int gametics)
+{
+    benchdemo_t *demo;
+    benchstats_t frame;
+
+    if (!recording)
+    {
+        return;
+    }
+
+    recording = false;
+    frameactive = false;
+
+    demo = &demos[numdemos - 1];
+    demo->gametics = gametics;
+    demo->realtime_us = I_GetTimeUS() - demostart;
+    demo->highwater = highwater;
+    demo->prelit = prelitstats;
+
+    frame = ComputeStats(demo, -1);
+
+    printf("%s: %i gametics in %.1f ms (%.1f tics/s), frame ms "
+           "min %.3f mean %.3f p50 %.3f p95 %.3f p99 %.3f max %.3f\n",
+           demo->name, demo->gametics, demo->realtime_us / 1000.0,
+           TicsPerSecond(demo), frame.min, frame.mean,
+           frame.p50, frame.p95, frame.p99, frame.max);
+
+    if (demo->prelit.hits + demo->prelit.misses > 0)
+    {
+        printf("%s: prelit cache hit rate %.1f%% (%i hits, %i misses)\n",
+               demo->name, 100.0 * PrelitHitRate(demo), demo->prelit.hits,
+               demo->prelit.misses);
+    }
+}
+
+void M_BenchBeginFrame(void)
+{
+    if (!recording)
+    {
+        return;
+    }
+
+    frameactive = true;
+    framestart = I_GetTimeUS();
+    memset(phasetime, 0, sizeof(phasetime));
+}
+
+void M_BenchEndFrame(void)
+{
+    benchdemo_t *demo;
+    benchtic_t *tic;
+
+    if (!recording || !frameactive)
+    {
+        return;
+    }
+
+    demo = &demos[numdemos - 1];
+
+    if (demo->numtics == demo->maxtics)
+    {
+        demo->maxtics = demo->maxtics ? demo->maxtics * 2 : 1024;
+        demo->tics = GrowArray(demo->tics,
+                               demo->maxtics * sizeof(*demo->tics));
+    }
+
+    tic = &demo->tics[demo->numtics++];
+    tic->frame_us = (uint32_t) (I_GetTimeUS() - framestart);
+    memcpy(tic->phase_us, phasetime, sizeof(phasetime));
+
+    frameactive = false;
+}
+
+void M_BenchBeginPhase(benchphase_t phase)
+{
+    if (recording)
+    {
+        phasestart[phase] = I_GetTimeUS();
+    }
+}
+
+void M_BenchEndPhase(benchphase_t phase)
+{
+    if (recording)
+    {
+        phasetime[phase] += (uint32_t) (I_GetTimeUS() - phasestart[phase]);
+    }
+}
+
+static void WriteStatsJSON(FILE *f, const char *name, benchstats_t *stats)
+{
+    fprintf(f, "      \"%s_ms\": { \"min\": %.3f, \"mean\": %.3f, "
+               "\"p50\": %.3f, \"p95\": %.3f, \"p99\": %.3f, "
+               "\"max\": %.3f },\n",
+            name, stats->min, stats->mean, stats->p50,
+            stats->p95, stats->p99, stats->max);
+}
+
+static void WriteColumnJSON(FILE *f, benchdemo_t *demo, int phase,
+                            boolean last)
+{
+    int i;
+
+    fprintf(f, "        \"%s_us\": [",
+            phase < 0 ? "frame" : phase_names[phase]);
+
+    for (i = 0; i < demo->numtics; ++i)
+    {
+        fprintf(f, "%s%u", i > 0 ? "," : "",
+                phase < 0 ? demo->tics[i].frame_us
+                          : demo->tics[i].phase_us[phase]);
+    }
+
+    fprintf(f, "]%s\n", last ? "" : ",");
+}
+
+static void WriteDemoJSON(FILE *f, benchdemo_t *demo)
+{
+    benchstats_t stats;
+    int histogram[NUMBUCKETS];
+    int i, j;
+
+    fprintf(f, "      \"name\": \"%s\",\n", demo->name);
+    fprintf(f, "      \"gametics\": %i,\n", demo->gametics);
+    fprintf(f, "      \"realtime_ms\": %.3f,\n", demo->realtime_us / 1000.0);
+    fprintf(f, "      \"tics_per_second\": %.3f,\n", TicsPerSecond(demo));
+
+    stats = ComputeStats(demo, -1);
+    WriteStatsJSON(f, "frame", &stats);
+
+    for (i = 0; i < NUMBENCHPHASES; ++i)
+    {
+        stats = ComputeStats(demo, i);
+        WriteStatsJSON(f, phase_names[i], &stats);
+    }
+
+    memset(histogram, 0, sizeof(histogram));
+
+    for (i = 0; i < demo->numtics; ++i)
+    {
+        for (j = 0; j < arrlen(histogram_bounds); ++j)
+        {
+            if (demo->tics[i].frame_us < histogram_bounds[j])
+            {
+                break;
+            }
+        }
+
+        ++histogram[j];
+    }
+
+    fprintf(f, "      \"histogram\": {\n        \"bounds_us\": [");
+
+    for (i = 0; i < arrlen(histogram_bounds); ++i)
+    {
+        fprintf(f, "%s%u", i > 0 ? ", " : "", histogram_bounds[i]);
+    }
+
+    fprintf(f, "],\n        \"counts\": [");
+
+    for (i = 0; i < NUMBUCKETS; ++i)
+    {
+        fprintf(f, "%s%i", i > 0 ? ", " : "", histogram[i]);
+    }
+
+    fprintf(f, "]\n      },\n");
+
+    fprintf(f, "      \"highwater\": { \"visplanes\": %i, \"drawsegs\": %i, "
+               "\"vissprites\": %i, \"openings\": %i, \"solidsegs\": %i },\n",
+            demo->highwater.visplanes, demo->highwater.drawsegs,
+            demo->highwater.vissprites, demo->highwater.openings,
+            demo->highwater.solidsegs);
+
+    fprintf(f, "      \"prelit\": { \"hits\": %i, \"misses\": %i, "
+               "\"hit_rate\": %.4f },\n",
+            demo->prelit.hits, demo->prelit.misses, PrelitHitRate(demo));
+
+    fprintf(f, "      \"tics\": {\n");
+    WriteColumnJSON(f, demo, -1, false);
+
+    for (i = 0; i < NUMBENCHPHASES; ++i)
+    {
+        WriteColumnJSON(f, demo, i, i == NUMBENCHPHASES - 1);
+    }
+
+    fprintf(f, "      }\n");
+}
+
+static void WriteReportJSON(FILE *f)
+{
+    int i;
+
+    fprintf(f, "{\n  \"demos\": [\n");
+
+    for (i = 0; i < numdemos; ++i)
+    {
+        fprintf(f, "    {\n");
+        WriteDemoJSON(f, &demos[i]);
+        fprintf(f, "    }%s\n", i < numdemos - 1 ? "," : "");
+    }
+
+    fprintf(f, "  ]\n}\n");
+}
+
+static void WriteReportCSV(FILE *f)
+{
+    benchtic_t *tic;
+    int i, j, k;
+
+    fprintf(f, "demo,tic,frame_us");
+
+    for (k = 0; k < NUMBENCHPHASES; ++k)
+    {
+        fprintf(f, ",%s_us", phase_names[k]);
+    }
+
+    fprintf(f, "\n");
+
+    for (i = 0; i < numdemos; ++i)
+    {
+        for (j = 0; j < demos[i].numtics; ++j)
+        {
+            tic = &demos[i].tics[j];
+            fprintf(f, "%s,%i,%u", demos[i].name, j, tic->frame_us);
+
+            for (k = 0; k < NUMBENCHPHASES; ++k)
+            {
+                fprintf(f, ",%u", tic->phase_us[k]);
+            }
+
+            fprintf(f, "\n");
+        }
+    }
+}
+
+boolean M_BenchWriteReport(void)
+{
+    FILE *f;
+    char *filename;
+    int p;
+
+    //!
+    // @arg <file>
+    // @category demo
+    //
+    // Write a benchmark report of the demos played with -timedemo to
+    // the given file: frame time statistics and the per-tic time spent
+    // in simulation, rendering and presentation. The report is written
+    // as CSV if the filename ends in .csv, otherwise as JSON.
+    //
+
+    p = M_CheckParmWithArgs("-benchreport", 1);
+
+    if (!p)
+    {
+        return false;
+    }
+
+    filename = myargv[p + 1];
+    f = fopen(filename, "w");
+
+    if (f == NULL)
+    {
+        printf("M_BenchWriteReport: failed to open %s\n", filename);
+        return true;
+    }
+
+    if (M_StringEndsWith(filename, ".csv"))
+    {
+        WriteReportCSV(f);
+    }
+    else
+    {
+        WriteReportJSON(f);
+    }
+
+    fclose(f);
+    printf("Benchmark report written to %s\n", filename);
+
+    return true;
+}
+
+//
+// Zone allocator microbenchmark
+//
+
+#define ZONEBENCH_SLOTS     8192
+#define ZONEBENCH_CHURN     2048
+#define ZONEBENCH_OPS       400000
+#define ZONEBENCH_BATCH     256
+
+static unsigned int benchseed;
+
+static unsigned int BenchRandom(void)
+{
+    // Own generator, M_Random() is part of the demo sync state
+
+    benchseed = benchseed * 1103515245 + 12345;
+
+    return (benchseed >> 8) & 0xffffff;
+}
+
+// Allocation sizes and tags roughly as seen during play: mostly small
+// thinkers and mobjs, some composite textures and sounds, a few large
+// level lumps.
+
+static void *BenchAlloc(void **user)
+{
+    unsigned int r;
+    int size, tag;
+
+    r = BenchRandom() % 100;
+
+    if (r < 85)
+    {
+        size = 32 + BenchRandom() % 224;
+    }
+    else if (r < 99)
+    {
+        size = 256 + BenchRandom() % 1792;
+    }
+    else
+    {
+        size = 4096 + BenchRandom() % 28672;
+    }
+
+    r = BenchRandom() % 10;
+
+    if (r < 5)
+    {
+        tag = PU_LEVEL;
+    }
+    else if (r < 8)
+    {
+        tag = PU_CACHE;
+    }
+    else
+    {
+        tag = PU_STATIC;
+    }
+
+    return Z_Malloc(size, tag, user);
+}
+
+void M_BenchZone(void)
+{
+    static void *slots[ZONEBENCH_SLOTS];
+    uint32_t *batches;
+    uint64_t start, total;
+    int numbatches;
+    int i, j, n;
+
+    benchseed = 1;
+    numbatches = ZONEBENCH_OPS / ZONEBENCH_BATCH;
+    batches = malloc(numbatches * sizeof(*batches));
+
+    // Fragment the heap: fill all slots, then free every other one.
+
+    for (i = 0; i < ZONEBENCH_SLOTS; ++i)
+    {
+        BenchAlloc(&slots[i]);
+    }
+
+    for (i = 0; i < ZONEBENCH_SLOTS; i += 2)
+    {
+        if (slots[i] != NULL)
+        {
+            Z_Free(slots[i]);
+        }
+    }
+
+    // Churn: every operation frees or allocates a random one of the
+    // short lived slots at the end, the rest stays allocated unless
+    // purged. Purged cache blocks have their slot cleared by the zone.
+
+    total = 0;
+
+    for (i = 0; i < numbatches; ++i)
+    {
+        start = I_GetTimeUS();
+
+        for (j = 0; j < ZONEBENCH_BATCH; ++j)
+        {
+            n = ZONEBENCH_SLOTS - 1 - BenchRandom() % ZONEBENCH_CHURN;
+
+            if (slots[n] != NULL)
+            {
+                Z_Free(slots[n]);
+            }
+            else
+            {
+                BenchAlloc(&slots[n]);
+            }
+        }
+
+        batches[i] = (uint32_t) (I_GetTimeUS() - start);
+        total += batches[i];
+    }
+
+    for (i = 0; i < ZONEBENCH_SLOTS; ++i)
+    {
+        if (slots[i] != NULL)
+        {
+            Z_Free(slots[i]);
+        }
+    }
+
+    qsort(batches, numbatches, sizeof(*batches), CompareUInt);
+
+    printf("M_BenchZone: %i operations in %.1f ms, ns per operation: "
+           "mean %.1f p50 %.1f p99 %.1f max %.1f\n",
+           numbatches * ZONEBENCH_BATCH, total / 1000.0,
+           total * 1000.0 / (numbatches * ZONEBENCH_BATCH),
+           batches[numbatches / 2] * 1000.0 / ZONEBENCH_BATCH,
+           batches[(numbatches * 99) / 100] * 1000.0 / ZONEBENCH_BATCH,
+           batches[numbatches - 1] * 1000.0 / ZONEBENCH_BATCH);
+
+    free(batches);
+}
+
@@ -0,0 +1,53 @@
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//      Timedemo benchmark: per-tic timing of the simulation, rendering
+//      and presentation phases, written to a JSON or CSV report.
+//
+
+
+#ifndef __M_BENCH__
+#define __M_BENCH__
+
+#include "doomtype.h"
+
+typedef enum
+{
+    bench_sim,          // P_Ticker
+    bench_render,       // R_RenderPlayerView
+    bench_present,      // I_FinishUpdate
+
+    NUMBENCHPHASES
+} benchphase_t;
+
+// Start/stop recording the frames of a timed demo.
+void M_BenchStartDemo(char *name);
+void M_BenchEndDemo(int gametics);
+
+// Frame and phase boundaries, these do nothing outside of a timed demo.
+void M_BenchBeginFrame(void);
+void M_BenchEndFrame(void);
+void M_BenchBeginPhase(benchphase_t phase);
+void M_BenchEndPhase(benchphase_t phase);
+
+// Write the report of all recorded demos to the file given with
+// -benchreport, returns false if no report was requested.
+boolean M_BenchWriteReport(void);
+
+// Time Z_Malloc/Z_Free under churn on a fragmented heap (-zonebench).
+void M_BenchZone(void);
+
+#endif
+
@@ -70,15 +70,7 @@ void M_MakeDirectory(char *path)
 // Check if a file exists
 boolean M_FileExists(char *filename)
 {
-    // SOKOL CHANGE
-    if (0 == strcmp(filename, "DOOM1.WAD")) {
-        return true;
-    }
-    else {
-        assert(false);
-        return false;
-    }
-    /*
+#ifdef DOOMGENERIC_HEADLESS
     FILE *fstream;
 
     fstream = fopen(filename, "r");
@@ -95,7 +87,16 @@ boolean M_FileExists(char *filename)
 
         return errno == EISDIR;
     }
-    */
+#else
+    // SOKOL CHANGE
+    if (0 == strcmp(filename, "DOOM1.WAD")) {
+        return true;
+    }
+    else {
+        assert(false);
+        return false;
+    }
+#endif
 }
 
 //
@@ -104,11 +105,8 @@ boolean M_FileExists(char *filename)
 
 long M_FileLength(FILE *handle)
 {
-    // SOKOL CHANGE
-    assert(false);
-    return 0;
-
-    /*
+    // SOKOL CHANGE: only works on an already open file, needed by the
+    // stdc_wad_file class in all builds
     long savedpos;
     long length;
 
@@ -123,7 +121,6 @@ long M_FileLength(FILE *handle)
     fseek(handle, savedpos, SEEK_SET);
 
     return length;
-    */
 }
 
 //
@@ -132,11 +129,7 @@ long M_FileLength(FILE *handle)
 
 boolean M_WriteFile(char *name, void *source, int length)
 {
-    // SOKOL CHANGE
-    assert(false);
-    return false;
-
-    /*
+#ifdef DOOMGENERIC_HEADLESS
     FILE *handle;
     int	count;
 	
@@ -152,7 +145,11 @@ boolean M_WriteFile(char *name, void *source, int length)
 	return false;
 		
     return true;
-    */
+#else
+    // SOKOL CHANGE
+    assert(false);
+    return false;
+#endif
 }
 
 
@@ -162,11 +159,7 @@ boolean M_WriteFile(char *name, void *source, int length)
 
 int M_ReadFile(char *name, byte **buffer)
 {
-    // SOKOL CHANGE
-    assert(false);
-    return 0;
-
-    /*
+#ifdef DOOMGENERIC_HEADLESS
     FILE *handle;
     int	count, length;
     byte *buf;
@@ -189,7 +182,11 @@ int M_ReadFile(char *name, byte **buffer)
 		
     *buffer = buf;
     return length;
-    */
+#else
+    // SOKOL CHANGE
+    assert(false);
+    return 0;
+#endif
 }
 
 // Returns the path to a temporary file of the given name, stored
@@ -0,0 +1,349 @@
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//      Hierarchical scoped profiler. Scopes are accumulated per frame
+//      and written as a Chrome trace (chrome://tracing, Perfetto).
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "doomtype.h"
+#include "i_system.h"
+#include "i_timer.h"
+#include "m_argv.h"
+
+#include "m_profile.h"
+
+#ifdef FEATURE_PROFILE
+
+#define MAXPROFNODES 128
+#define MAXPROFDEPTH 32
+
+// A scope in the call tree. The same function called from different
+// parents gets a node for every parent.
+
+typedef struct
+{
+    const char *name;
+    int parent;
+    int firstchild;
+    int nextsibling;
+
+    uint64_t start;             // start of the current call
+    uint64_t firststart;        // start of the first call this frame
+    uint64_t time;              // accumulated this frame
+    int calls;                  // calls this frame
+
+    uint64_t totaltime;         // accumulated over all frames
+} profnode_t;
+
+// One accumulated scope of a frame. Calls of a scope are merged into
+// one event, children are laid out one after another inside their
+// parent, so the trace shows where the time went, not when.
+
+typedef struct
+{
+    int node;
+    int calls;
+    uint64_t ts;
+    uint32_t dur;
+} profevent_t;
+
+boolean profiling;
+
+static char *tracefile;
+
+static profnode_t nodes[MAXPROFNODES];
+static int numnodes;
+
+static int stack[MAXPROFDEPTH];
+static int depth;
+static boolean inframe;
+
+static int numframes;
+static uint64_t firstframe;
+
+static profevent_t *events;
+static int numevents;
+static int maxevents;
+
+static int NewNode(const char *name, int parent)
+{
+    profnode_t *node;
+    int *link;
+
+    if (numnodes == MAXPROFNODES)
+    {
+        I_Error("M_ProfileBegin: more than %i scopes", MAXPROFNODES);
+    }
+
+    node = &nodes[numnodes];
+    node->name = name;
+    node->parent = parent;
+    node->firstchild = -1;
+    node->nextsibling = -1;
+
+    // Append, so that siblings stay in the order they were first seen
+
+    if (parent >= 0)
+    {
+        link = &nodes[parent].firstchild;
+
+        while (*link >= 0)
+        {
+            link = &nodes[*link].nextsibling;
+        }
+
+        *link = numnodes;
+    }
+
+    return numnodes++;
+}
+
+void M_ProfileBegin(const char *name)
+{
+    int parent;
+    int i;
+
+    if (!inframe)
+    {
+        return;
+    }
+
+    if (depth == MAXPROFDEPTH)
+    {
+        I_Error("M_ProfileBegin: scopes nested too deep");
+    }
+
+    parent = stack[depth - 1];
+
+    for (i = nodes[parent].firstchild; i >= 0; i = nodes[i].nextsibling)
+    {
+        if (nodes[i].name == name)
+        {
+            break;
+        }
+    }
+
+    if (i < 0)
+    {
+        i = NewNode(name, parent);
+    }
+
+    stack[depth++] = i;
+    nodes[i].start = I_GetTimeUS();
+
+    if (nodes[i].calls == 0)
+    {
+        nodes[i].firststart = nodes[i].start;
+    }
+}
+
+void M_ProfileEnd(void)
+{
+    profnode_t *node;
+
+    if (!inframe)
+    {
+        return;
+    }
+
+    if (depth <= 1)
+    {
+        I_Error("M_ProfileEnd: no open scope");
+    }
+
+    node = &nodes[stack[--depth]];
+    node->time += I_GetTimeUS() - node->start;
+    ++node->calls;
+}
+
+void M_ProfileBeginFrame(void)
+{
+    if (!profiling)
+    {
+        return;
+    }
+
+    inframe = true;
+    depth = 1;
+    stack[0] = 0;
+
+    nodes[0].start = nodes[0].firststart = I_GetTimeUS();
+
+    if (numframes == 0)
+    {
+        firstframe = nodes[0].start;
+    }
+}
+
+static void AddEvent(int node, uint64_t ts)
+{
+    profevent_t *event;
+
+    if (numevents == maxevents)
+    {
+        maxevents = maxevents ? maxevents * 2 : 4096;
+        events = realloc(events, maxevents * sizeof(*events));
+
+        if (events == NULL)
+        {
+            I_Error("M_ProfileEndFrame: failed to grow the event buffer");
+        }
+    }
+
+    event = &events[numevents++];
+    event->node = node;
+    event->calls = nodes[node].calls;
+    event->ts = ts;
+    event->dur = (uint32_t) nodes[node].time;
+}
+
+// Emit the events of a node and its children and reset them for the
+// next frame.
+
+static void EmitNode(int n, uint64_t ts)
+{
+    profnode_t *node = &nodes[n];
+    uint64_t cursor;
+    int i;
+
+    AddEvent(n, ts);
+
+    cursor = ts;
+
+    for (i = node->firstchild; i >= 0; i = nodes[i].nextsibling)
+    {
+        if (nodes[i].calls > 0)
+        {
+            ts = nodes[i].firststart > cursor ? nodes[i].firststart : cursor;
+            EmitNode(i, ts);
+            cursor = ts + nodes[i].time;
+        }
+    }
+
+    node->totaltime += node->time;
+    node->time = 0;
+    node->calls = 0;
+}
+
+void M_ProfileEndFrame(void)
+{
+    if (!profiling || !inframe)
+    {
+        return;
+    }
+
+    if (depth != 1)
+    {
+        I_Error("M_ProfileEndFrame: %s not closed",
+                nodes[stack[depth - 1]].name);
+    }
+
+    inframe = false;
+
+    nodes[0].time = I_GetTimeUS() - nodes[0].start;
+    nodes[0].calls = 1;
+
+    EmitNode(0, nodes[0].firststart);
+    ++numframes;
+}
+
+static void PrintSummary(int n, int level)
+{
+    int i;
+
+    printf("%*s%-*s %10.3f %6.1f%%\n", level * 2, "", 32 - level * 2,
+           nodes[n].name, nodes[n].totaltime / 1000.0 / numframes,
+           nodes[0].totaltime > 0 ?
+               nodes[n].totaltime * 100.0 / nodes[0].totaltime : 0.0);
+
+    for (i = nodes[n].firstchild; i >= 0; i = nodes[i].nextsibling)
+    {
+        PrintSummary(i, level + 1);
+    }
+}
+
+static void M_ProfileWrite(void)
+{
+    FILE *f;
+    profevent_t *event;
+    int i;
+
+    if (numframes == 0)
+    {
+        return;
+    }
+
+    printf("%-32s %10s %7s\n", "scope", "ms/frame", "frame");
+    PrintSummary(0, 0);
+
+    f = fopen(tracefile, "w");
+
+    if (f == NULL)
+    {
+        printf("M_ProfileWrite: failed to open %s\n", tracefile);
+        return;
+    }
+
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+    for (i = 0; i < numevents; ++i)
+    {
+        event = &events[i];
+        fprintf(f, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,"
+                   "\"ts\":%llu,\"dur\":%u,\"args\":{\"calls\":%i}}%s\n",
+                nodes[event->node].name,
+                (unsigned long long) (event->ts - firstframe),
+                event->dur, event->calls,
+                i < numevents - 1 ? "," : "");
+    }
+
+    fprintf(f, "]}\n");
+    fclose(f);
+
+    printf("Profile of %i frames written to %s\n", numframes, tracefile);
+}
+
+void M_ProfileInit(void)
+{
+    int p;
+
+    //!
+    // @arg <file>
+    //
+    // Profile the renderer, playsim and sound mixing and write the
+    // per-frame timings to the given file at exit, as a Chrome trace
+    // event file (open in chrome://tracing or ui.perfetto.dev).
+    //
+
+    p = M_CheckParmWithArgs("-profile", 1);
+
+    if (!p)
+    {
+        return;
+    }
+
+    tracefile = myargv[p + 1];
+    numnodes = 0;
+    NewNode("frame", -1);
+
+    profiling = true;
+    I_AtExit(M_ProfileWrite, true);
+}
+
+#endif
+
@@ -0,0 +1,60 @@
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//      Hierarchical scoped profiler. Scopes are accumulated per frame
+//      and written as a Chrome trace (chrome://tracing, Perfetto).
+//
+
+
+#ifndef __M_PROFILE__
+#define __M_PROFILE__
+
+#include "doomtype.h"
+#include "doomfeatures.h"
+
+#ifdef FEATURE_PROFILE
+
+extern boolean profiling;
+
+// Reads -profile, the trace is written at exit.
+void M_ProfileInit(void);
+
+// Frame boundaries, called by the backend which owns the main loop.
+void M_ProfileBeginFrame(void);
+void M_ProfileEndFrame(void);
+
+// Scopes nest and must be closed in reverse order. The name must be a
+// string literal, scopes are identified by the pointer.
+void M_ProfileBegin(const char *name);
+void M_ProfileEnd(void);
+
+#define PROFILE_BEGIN(name) \
+    do { if (profiling) M_ProfileBegin(name); } while (0)
+#define PROFILE_END() \
+    do { if (profiling) M_ProfileEnd(); } while (0)
+
+#else
+
+#define M_ProfileInit()
+#define M_ProfileBeginFrame()
+#define M_ProfileEndFrame()
+
+#define PROFILE_BEGIN(name)
+#define PROFILE_END()
+
+#endif
+
+#endif
+
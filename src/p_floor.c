@@ -49,6 +49,15 @@ T_MovePlane
 {
     boolean	flag;
     fixed_t	lastpos;
+
+    // SOKOL CHANGE: the heights the tic starts at, display frames
+    //  between tics draw the sector moving from there
+    if (sector->oldgametic != gametic)
+    {
+	sector->oldfloorheight = sector->floorheight;
+	sector->oldceilingheight = sector->ceilingheight;
+	sector->oldgametic = gametic;
+    }
 	
     switch(floorOrCeiling)
     {
@@ -270,7 +279,7 @@ EV_DoFloor
 	
 	// new floor thinker
 	rtn = 1;
-	floor = Z_Malloc (sizeof(*floor), PU_LEVSPEC, 0);
+	floor = P_AllocThinker (pool_floor);
 	P_AddThinker (&floor->thinker);
 	sec->specialdata = floor;
 	floor->thinker.function.acp1 = (actionf_p1) T_MoveFloor;
@@ -473,7 +482,7 @@ EV_BuildStairs
 	
 	// new floor thinker
 	rtn = 1;
-	floor = Z_Malloc (sizeof(*floor), PU_LEVSPEC, 0);
+	floor = P_AllocThinker (pool_floor);
 	P_AddThinker (&floor->thinker);
 	sec->specialdata = floor;
 	floor->thinker.function.acp1 = (actionf_p1) T_MoveFloor;
@@ -526,7 +535,7 @@ EV_BuildStairs
 					
 		sec = tsec;
 		secnum = newsecnum;
-		floor = Z_Malloc (sizeof(*floor), PU_LEVSPEC, 0);
+		floor = P_AllocThinker (pool_floor);
 
 		P_AddThinker (&floor->thinker);
 
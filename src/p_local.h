@@ -71,6 +71,26 @@ void P_InitThinkers (void);
 void P_AddThinker (thinker_t* thinker);
 void P_RemoveThinker (thinker_t* thinker);
 
+// SOKOL CHANGE: every kind of thinker has its own slab pool, and
+// they are run pool by pool unless the Vanilla order is needed.
+typedef enum
+{
+    pool_mobj,
+    pool_ceiling,
+    pool_door,
+    pool_floor,
+    pool_plat,
+    pool_flash,
+    pool_strobe,
+    pool_glow,
+    pool_fireflicker,
+
+    NUMTHINKERPOOLS
+} thinkerpool_t;
+
+void* P_AllocThinker (thinkerpool_t pool);
+void P_FreeThinker (thinker_t* thinker);
+
 
 //
 // P_PSPR
@@ -114,6 +134,7 @@ void 	P_RemoveMobj (mobj_t* th);
 mobj_t* P_SubstNullMobj (mobj_t* th);
 boolean	P_SetMobjState (mobj_t* mobj, statenum_t state);
 void 	P_MobjThinker (mobj_t* mobj);
+void	P_SetOldPosition (mobj_t* mobj);
 
 void	P_SpawnPuff (fixed_t x, fixed_t y, fixed_t z);
 void 	P_SpawnBlood (fixed_t x, fixed_t y, fixed_t z, int damage);
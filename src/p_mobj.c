@@ -435,11 +435,30 @@ P_NightmareRespawn (mobj_t* mobj)
 }
 
 
+//
+// P_SetOldPosition
+// SOKOL CHANGE: display frames between this tic and the next
+//  are drawn moving from the current position and angle.
+//
+void P_SetOldPosition (mobj_t* mobj)
+{
+    mobj->oldx = mobj->x;
+    mobj->oldy = mobj->y;
+    mobj->oldz = mobj->z;
+    mobj->oldangle = mobj->angle;
+    mobj->oldgametic = gametic;
+}
+
+
 //
 // P_MobjThinker
 //
 void P_MobjThinker (mobj_t* mobj)
 {
+    // SOKOL CHANGE: where the tic starts, unless already known
+    if (mobj->oldgametic != gametic)
+	P_SetOldPosition (mobj);
+
     // momentum movement
     if (mobj->momx
 	|| mobj->momy
@@ -513,7 +532,7 @@ P_SpawnMobj
     state_t*	st;
     mobjinfo_t*	info;
 	
-    mobj = Z_Malloc (sizeof(*mobj), PU_LEVEL, NULL);
+    mobj = P_AllocThinker (pool_mobj);
     memset (mobj, 0, sizeof (*mobj));
     info = &mobjinfo[type];
 	
@@ -552,6 +571,9 @@ P_SpawnMobj
     else 
 	mobj->z = z;
 
+    // SOKOL CHANGE: drawn from where it was spawned
+    P_SetOldPosition (mobj);
+
     mobj->thinker.function.acp1 = (actionf_p1)P_MobjThinker;
 	
     P_AddThinker (&mobj->thinker);
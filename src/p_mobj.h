@@ -276,6 +276,15 @@ typedef struct mobj_s
 
     // Thing being chased/attacked for tracers.
     struct mobj_s*	tracer;	
+
+    // SOKOL CHANGE: position and angle before the last tic, display
+    //  frames between tics are drawn in between. Only valid if
+    //  oldgametic is the last tic.
+    fixed_t		oldx;
+    fixed_t		oldy;
+    fixed_t		oldz;
+    angle_t		oldangle;
+    int			oldgametic;
     
 } mobj_t;
 
@@ -63,6 +63,16 @@ subsector_t*	subsectors;
 int		numnodes;
 node_t*		nodes;
 
+// SOKOL CHANGE: the nodes again in depth first order
+int		bsproot;
+int		bspdepth;
+fixed_t*	bspx;
+fixed_t*	bspy;
+fixed_t*	bspdx;
+fixed_t*	bspdy;
+unsigned short*	bspchildren[2];
+bspbbox_t*	bspbbox;
+
 int		numlines;
 line_t*		lines;
 
@@ -127,7 +137,7 @@ void P_LoadVertexes (int lump)
     numvertexes = W_LumpLength (lump) / sizeof(mapvertex_t);
 
     // Allocate zone memory for buffer.
-    vertexes = Z_Malloc (numvertexes*sizeof(vertex_t),PU_LEVEL,0);	
+    vertexes = Z_ArenaMalloc (numvertexes*sizeof(vertex_t));	
 
     // Load data into cache.
     data = W_CacheLumpNum (lump, PU_STATIC);
@@ -181,7 +191,7 @@ void P_LoadSegs (int lump)
     int                 sidenum;
 	
     numsegs = W_LumpLength (lump) / sizeof(mapseg_t);
-    segs = Z_Malloc (numsegs*sizeof(seg_t),PU_LEVEL,0);	
+    segs = Z_ArenaMalloc (numsegs*sizeof(seg_t));	
     memset (segs, 0, numsegs*sizeof(seg_t));
     data = W_CacheLumpNum (lump,PU_STATIC);
 	
@@ -241,7 +251,7 @@ void P_LoadSubsectors (int lump)
     subsector_t*	ss;
 	
     numsubsectors = W_LumpLength (lump) / sizeof(mapsubsector_t);
-    subsectors = Z_Malloc (numsubsectors*sizeof(subsector_t),PU_LEVEL,0);	
+    subsectors = Z_ArenaMalloc (numsubsectors*sizeof(subsector_t));	
     data = W_CacheLumpNum (lump,PU_STATIC);
 	
     ms = (mapsubsector_t *)data;
@@ -270,7 +280,7 @@ void P_LoadSectors (int lump)
     sector_t*		ss;
 	
     numsectors = W_LumpLength (lump) / sizeof(mapsector_t);
-    sectors = Z_Malloc (numsectors*sizeof(sector_t),PU_LEVEL,0);	
+    sectors = Z_ArenaMalloc (numsectors*sizeof(sector_t));	
     memset (sectors, 0, numsectors*sizeof(sector_t));
     data = W_CacheLumpNum (lump,PU_STATIC);
 	
@@ -305,7 +315,7 @@ void P_LoadNodes (int lump)
     node_t*	no;
 	
     numnodes = W_LumpLength (lump) / sizeof(mapnode_t);
-    nodes = Z_Malloc (numnodes*sizeof(node_t),PU_LEVEL,0);	
+    nodes = Z_ArenaMalloc (numnodes*sizeof(node_t));	
     data = W_CacheLumpNum (lump,PU_STATIC);
 	
     mn = (mapnode_t *)data;
@@ -329,6 +339,123 @@ void P_LoadNodes (int lump)
 }
 
 
+//
+// P_LayoutNodes
+// SOKOL CHANGE: lays the nodes out again in depth first order,
+//  the first child of each right after it.
+//
+void P_LayoutNodes (void)
+{
+    int*	position;
+    int*	depth;
+    int*	stack;
+    int		count;
+    int		next;
+    int		num;
+    int		child;
+    int		i;
+    int		j;
+
+    bsproot = numnodes ? 0 : NF_SUBSECTOR;
+    bspdepth = 0;
+
+    bspx = Z_ArenaMalloc (numnodes*sizeof(*bspx));
+    bspy = Z_ArenaMalloc (numnodes*sizeof(*bspy));
+    bspdx = Z_ArenaMalloc (numnodes*sizeof(*bspdx));
+    bspdy = Z_ArenaMalloc (numnodes*sizeof(*bspdy));
+    bspchildren[0] = Z_ArenaMalloc (numnodes*sizeof(*bspchildren[0]));
+    bspchildren[1] = Z_ArenaMalloc (numnodes*sizeof(*bspchildren[1]));
+    bspbbox = Z_ArenaMalloc (numnodes*sizeof(*bspbbox));
+
+    if (!numnodes)
+	return;
+
+    position = Z_Malloc (numnodes*sizeof(*position), PU_STATIC, NULL);
+    depth = Z_Malloc (numnodes*sizeof(*depth), PU_STATIC, NULL);
+    stack = Z_Malloc ((numnodes+1)*sizeof(*stack), PU_STATIC, NULL);
+
+    for (i=0 ; i<numnodes ; i++)
+	position[i] = -1;
+
+    // the head node is the last node output
+    count = 0;
+    next = 0;
+    stack[count++] = numnodes-1;
+
+    while (count)
+    {
+	num = stack[--count];
+
+	if (position[num] != -1)
+	    I_Error ("P_LayoutNodes: node %i is reached twice", num);
+
+	position[num] = next++;
+
+	for (j=1 ; j>=0 ; j--)
+	{
+	    child = nodes[num].children[j];
+
+	    if (child & NF_SUBSECTOR)
+		continue;
+
+	    if (child >= numnodes)
+		I_Error ("P_LayoutNodes: node %i has child %i with "
+			 "numnodes = %i", num, child, numnodes);
+
+	    stack[count++] = child;
+	}
+    }
+
+    for (i=0 ; i<numnodes ; i++)
+    {
+	if (position[i] == -1)
+	    continue;
+
+	num = position[i];
+	bspx[num] = nodes[i].x;
+	bspy[num] = nodes[i].y;
+	bspdx[num] = nodes[i].dx;
+	bspdy[num] = nodes[i].dy;
+	memcpy (bspbbox[num], nodes[i].bbox, sizeof(bspbbox[num]));
+
+	for (j=0 ; j<2 ; j++)
+	{
+	    child = nodes[i].children[j];
+
+	    if (child & NF_SUBSECTOR)
+		bspchildren[j][num] = child;
+	    else
+		bspchildren[j][num] = position[child];
+	}
+    }
+
+    // nodes the tree never reaches
+    for (num=next ; num<numnodes ; num++)
+	bspchildren[0][num] = bspchildren[1][num] = NF_SUBSECTOR;
+
+    // parents come before their children
+    memset (depth, 0, numnodes*sizeof(*depth));
+
+    for (num=0 ; num<next ; num++)
+    {
+	depth[num]++;
+
+	if (depth[num] > bspdepth)
+	    bspdepth = depth[num];
+
+	for (j=0 ; j<2 ; j++)
+	{
+	    if (!(bspchildren[j][num] & NF_SUBSECTOR))
+		depth[bspchildren[j][num]] = depth[num];
+	}
+    }
+
+    Z_Free (stack);
+    Z_Free (depth);
+    Z_Free (position);
+}
+
+
 //
 // P_LoadThings
 //
@@ -399,7 +526,7 @@ void P_LoadLineDefs (int lump)
     vertex_t*		v2;
 	
     numlines = W_LumpLength (lump) / sizeof(maplinedef_t);
-    lines = Z_Malloc (numlines*sizeof(line_t),PU_LEVEL,0);	
+    lines = Z_ArenaMalloc (numlines*sizeof(line_t));	
     memset (lines, 0, numlines*sizeof(line_t));
     data = W_CacheLumpNum (lump,PU_STATIC);
 	
@@ -478,7 +605,7 @@ void P_LoadSideDefs (int lump)
     side_t*		sd;
 	
     numsides = W_LumpLength (lump) / sizeof(mapsidedef_t);
-    sides = Z_Malloc (numsides*sizeof(side_t),PU_LEVEL,0);	
+    sides = Z_ArenaMalloc (numsides*sizeof(side_t));	
     memset (sides, 0, numsides*sizeof(side_t));
     data = W_CacheLumpNum (lump,PU_STATIC);
 	
@@ -510,7 +637,7 @@ void P_LoadBlockMap (int lump)
     lumplen = W_LumpLength(lump);
     count = lumplen / 2;
 	
-    blockmaplump = Z_Malloc(lumplen, PU_LEVEL, NULL);
+    blockmaplump = Z_ArenaMalloc(lumplen);
     W_ReadLump(lump, blockmaplump);
     blockmap = blockmaplump + 4;
 
@@ -531,7 +658,7 @@ void P_LoadBlockMap (int lump)
     // Clear out mobj chains
 
     count = sizeof(*blocklinks) * bmapwidth * bmapheight;
-    blocklinks = Z_Malloc(count, PU_LEVEL, 0);
+    blocklinks = Z_ArenaMalloc(count);
     memset(blocklinks, 0, count);
 }
 
@@ -578,7 +705,7 @@ void P_GroupLines (void)
     }
 
     // build line tables for each sector	
-    linebuffer = Z_Malloc (totallines*sizeof(line_t *), PU_LEVEL, 0);
+    linebuffer = Z_ArenaMalloc (totallines*sizeof(line_t *));
 
     for (i=0; i<numsectors; ++i)
     {
@@ -724,13 +851,17 @@ static void P_LoadReject(int lumpnum)
 
     lumplen = W_LumpLength(lumpnum);
 
+    // SOKOL CHANGE: read into the level arena rather than caching
+    // the lump, so it sits with the rest of the level data.
+
     if (lumplen >= minlength)
     {
-        rejectmatrix = W_CacheLumpNum(lumpnum, PU_LEVEL);
+        rejectmatrix = Z_ArenaMalloc(lumplen);
+        W_ReadLump(lumpnum, rejectmatrix);
     }
     else
     {
-        rejectmatrix = Z_Malloc(minlength, PU_LEVEL, &rejectmatrix);
+        rejectmatrix = Z_ArenaMalloc(minlength);
         W_ReadLump(lumpnum, rejectmatrix);
 
         PadRejectArray(rejectmatrix + lumplen, minlength - lumplen);
@@ -768,6 +899,10 @@ P_SetupLevel
 
     Z_FreeTags (PU_LEVEL, PU_PURGELEVEL-1);
 
+    // SOKOL CHANGE: the map data of the last level is in the level
+    // arena, the thinkers are still zone blocks tagged PU_LEVEL.
+    Z_ArenaReset ();
+
     // UNUSED W_Profile ();
     P_InitThinkers ();
 	   
@@ -801,6 +936,7 @@ P_SetupLevel
     P_LoadLineDefs (lumpnum+ML_LINEDEFS);
     P_LoadSubsectors (lumpnum+ML_SSECTORS);
     P_LoadNodes (lumpnum+ML_NODES);
+    P_LayoutNodes ();
     P_LoadSegs (lumpnum+ML_SEGS);
 
     P_GroupLines ();
@@ -831,6 +967,9 @@ P_SetupLevel
     // build subsector connect matrix
     //	UNUSED P_ConnectSubsectors ();
 
+    // SOKOL CHANGE: the wall columns are looked up once per level
+    R_ResolveLevelColumns ();
+
     // preload graphics
     if (precache)
 	R_PrecacheLevel ();
@@ -21,6 +21,7 @@
 #include "doomdef.h"
 
 #include "i_system.h"
+#include "z_zone.h"
 #include "p_local.h"
 
 // State.
@@ -254,40 +255,56 @@ boolean P_CrossSubsector (int num)
 // P_CrossBSPNode
 // Returns true
 //  if strace crosses the given node successfully.
+// SOKOL CHANGE: walks the depth first node arrays with a stack of the
+//  ending sides still to cross, bspnum is a position in them.
 //
+static int*	sightstack;
+
 boolean P_CrossBSPNode (int bspnum)
 {
-    node_t*	bsp;
+    divline_t	partition;
     int		side;
+    int		count;
 
-    if (bspnum & NF_SUBSECTOR)
-    {
-	if (bspnum == -1)
-	    return P_CrossSubsector (0);
-	else
-	    return P_CrossSubsector (bspnum&(~NF_SUBSECTOR));
-    }
-		
-    bsp = &nodes[bspnum];
-    
-    // decide which side the start point is on
-    side = P_DivlineSide (strace.x, strace.y, (divline_t *)bsp);
-    if (side == 2)
-	side = 0;	// an "on" should cross both sides
-
-    // cross the starting side
-    if (!P_CrossBSPNode (bsp->children[side]) )
-	return false;
-	
-    // the partition plane is crossed here
-    if (side == P_DivlineSide (t2x, t2y,(divline_t *)bsp))
+    if (!sightstack)
+	sightstack = Z_Malloc ((bspdepth+1)*sizeof(*sightstack), PU_LEVEL,
+			       &sightstack);
+
+    count = 0;
+
+    for (;;)
     {
-	// the line doesn't touch the other side
-	return true;
+	if (bspnum & NF_SUBSECTOR)
+	{
+	    if (!P_CrossSubsector (bspnum&(~NF_SUBSECTOR)))
+		return false;
+
+	    // cross the ending side put off last
+	    if (!count)
+		return true;
+
+	    bspnum = sightstack[--count];
+	    continue;
+	}
+
+	partition.x = bspx[bspnum];
+	partition.y = bspy[bspnum];
+	partition.dx = bspdx[bspnum];
+	partition.dy = bspdy[bspnum];
+
+	// decide which side the start point is on
+	side = P_DivlineSide (strace.x, strace.y, &partition);
+	if (side == 2)
+	    side = 0;	// an "on" should cross both sides
+
+	// the partition plane is crossed here,
+	//  the ending side is crossed after the starting side
+	if (side != P_DivlineSide (t2x, t2y, &partition))
+	    sightstack[count++] = bspchildren[side^1][bspnum];
+
+	// cross the starting side
+	bspnum = bspchildren[side][bspnum];
     }
-    
-    // cross the ending side		
-    return P_CrossBSPNode (bsp->children[side^1]);
 }
 
 
@@ -344,7 +361,8 @@ P_CheckSight
     strace.dy = t2->y - t1->y;
 
     // the head node is the last node output
-    return P_CrossBSPNode (numnodes-1);	
+    // SOKOL CHANGE: and laid out first
+    return P_CrossBSPNode (bsproot);
 }
 
 
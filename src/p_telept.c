@@ -124,6 +124,11 @@ EV_Teleport
 
 		thing->angle = m->angle;
 		thing->momx = thing->momy = thing->momz = 0;
+
+		// SOKOL CHANGE: not drawn moving across the map
+		P_SetOldPosition (thing);
+		if (thing->player)
+		    thing->player->oldviewz = thing->player->viewz;
 		return 1;
 	    }	
 	}
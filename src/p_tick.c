@@ -20,6 +20,7 @@
 
 #include "z_zone.h"
 #include "p_local.h"
+#include "m_profile.h"
 
 #include "doomstat.h"
 
@@ -28,7 +29,7 @@ int	leveltime;
 
 //
 // THINKERS
-// All thinkers should be allocated by Z_Malloc
+// All thinkers should be allocated by P_AllocThinker
 // so they can be operated on uniformly.
 // The actual structures will vary in size,
 // but the first element must be thinker_t.
@@ -40,12 +41,160 @@ int	leveltime;
 thinker_t	thinkercap;
 
 
+//
+// THINKER POOLS
+//
+// SOKOL CHANGE: thinkers aren't zone blocks of their own, they are
+// allocated from fixed-size slots in slabs of their type. The slabs
+// are static zone blocks and are reused from level to level. Every
+// thinker is still linked into thinkercap, which keeps the Vanilla
+// order for demos, savegames and the code that searches for things.
+//
+
+#define SLABSLOTS	64
+
+typedef struct thinkslot_s
+{
+    struct thinkslot_s*	nextfree;
+    int			pool;
+    boolean		inuse;
+} thinkslot_t;
+
+typedef struct thinkslab_s
+{
+    struct thinkslab_s*	next;
+} thinkslab_t;
+
+typedef struct
+{
+    int			size;		// of the thinker
+    int			slotsize;	// including the slot header
+    thinkslab_t*	slabs;
+    thinkslab_t*	lastslab;
+    thinkslot_t*	freeslots;
+} pool_t;
+
+static pool_t pools[NUMTHINKERPOOLS] =
+{
+    { sizeof(mobj_t), 0, NULL, NULL, NULL },
+    { sizeof(ceiling_t), 0, NULL, NULL, NULL },
+    { sizeof(vldoor_t), 0, NULL, NULL, NULL },
+    { sizeof(floormove_t), 0, NULL, NULL, NULL },
+    { sizeof(plat_t), 0, NULL, NULL, NULL },
+    { sizeof(lightflash_t), 0, NULL, NULL, NULL },
+    { sizeof(strobe_t), 0, NULL, NULL, NULL },
+    { sizeof(glow_t), 0, NULL, NULL, NULL },
+    { sizeof(fireflicker_t), 0, NULL, NULL, NULL },
+};
+
+
+static thinkslot_t *SlabSlot(pool_t *pool, thinkslab_t *slab, int i)
+{
+    return (thinkslot_t *) ((byte *) (slab + 1) + i * pool->slotsize);
+}
+
+// Put all slots of a slab on the free list, lowest address first.
+
+static void FreeSlab(pool_t *pool, thinkslab_t *slab)
+{
+    thinkslot_t*	slot;
+    int			i;
+
+    for (i = SLABSLOTS - 1; i >= 0; --i)
+    {
+	slot = SlabSlot(pool, slab, i);
+	slot->pool = pool - pools;
+	slot->inuse = false;
+	slot->nextfree = pool->freeslots;
+	pool->freeslots = slot;
+    }
+}
+
+static void NewSlab(pool_t *pool)
+{
+    thinkslab_t*	slab;
+
+    if (pool->slotsize == 0)
+    {
+	pool->slotsize = sizeof(thinkslot_t) + pool->size;
+	pool->slotsize = (pool->slotsize + sizeof(void *) - 1)
+	               & ~(sizeof(void *) - 1);
+    }
+
+    slab = Z_Malloc(sizeof(thinkslab_t) + SLABSLOTS * pool->slotsize,
+                    PU_STATIC, NULL);
+    slab->next = NULL;
+
+    if (pool->lastslab != NULL)
+	pool->lastslab->next = slab;
+    else
+	pool->slabs = slab;
+
+    pool->lastslab = slab;
+
+    FreeSlab(pool, slab);
+}
+
+
+//
+// P_AllocThinker
+// The memory is not cleared, just as from Z_Malloc.
+//
+void* P_AllocThinker (thinkerpool_t p)
+{
+    pool_t*		pool;
+    thinkslot_t*	slot;
+
+    pool = &pools[p];
+
+    if (pool->freeslots == NULL)
+	NewSlab(pool);
+
+    slot = pool->freeslots;
+    pool->freeslots = slot->nextfree;
+    slot->inuse = true;
+
+    return slot + 1;
+}
+
+
+//
+// P_FreeThinker
+// The thinker must not be in the thinker list anymore.
+//
+void P_FreeThinker (thinker_t* thinker)
+{
+    thinkslot_t*	slot;
+    pool_t*		pool;
+
+    slot = (thinkslot_t *) thinker - 1;
+    pool = &pools[slot->pool];
+
+    slot->inuse = false;
+    slot->nextfree = pool->freeslots;
+    pool->freeslots = slot;
+}
+
+
 //
 // P_InitThinkers
 //
 void P_InitThinkers (void)
 {
+    pool_t*		pool;
+    thinkslab_t*	slab;
+
     thinkercap.prev = thinkercap.next  = &thinkercap;
+
+    // all thinkers of the last level are gone,
+    // free every slot in reverse so the first slab is used first
+    for (pool = pools; pool < pools + NUMTHINKERPOOLS; ++pool)
+    {
+	pool->freeslots = NULL;
+
+	for (slab = pool->slabs; slab != NULL; slab = slab->next)
+	    FreeSlab(pool, slab);
+    }
 }
 
 
@@ -88,6 +237,50 @@ void P_AllocateThinker (thinker_t*	thinker)
 
 
 
+static void RunThinker (thinker_t* thinker)
+{
+    if ( thinker->function.acv == (actionf_v)(-1) )
+    {
+	// time to remove it
+	thinker->next->prev = thinker->prev;
+	thinker->prev->next = thinker->next;
+	P_FreeThinker (thinker);
+    }
+    else
+    {
+	if (thinker->function.acp1)
+	    thinker->function.acp1 (thinker);
+    }
+}
+
+// SOKOL CHANGE: walk the pools in memory order instead of chasing the
+// list. Whether a thinker spawned during the walk runs this tic
+// depends on the slot it got, which is why demos and netgames use the
+// list.
+
+static void RunThinkerPools (void)
+{
+    pool_t*		pool;
+    thinkslab_t*	slab;
+    thinkslot_t*	slot;
+    int			i;
+
+    for (pool = pools; pool < pools + NUMTHINKERPOOLS; ++pool)
+    {
+	for (slab = pool->slabs; slab != NULL; slab = slab->next)
+	{
+	    for (i = 0; i < SLABSLOTS; ++i)
+	    {
+		slot = SlabSlot(pool, slab, i);
+
+		if (slot->inuse)
+		    RunThinker ((thinker_t *) (slot + 1));
+	    }
+	}
+    }
+}
+
+
 //
 // P_RunThinkers
 //
@@ -95,21 +288,18 @@ void P_RunThinkers (void)
 {
     thinker_t*	currentthinker;
 
+    if (!vanillathinkers && !demoplayback && !demorecording && !netgame)
+    {
+	RunThinkerPools ();
+	return;
+    }
+
+    // a freed thinker keeps its links, and a thinker spawned by the
+    // last one in the list still runs this tic
     currentthinker = thinkercap.next;
     while (currentthinker != &thinkercap)
     {
-	if ( currentthinker->function.acv == (actionf_v)(-1) )
-	{
-	    // time to remove it
-	    currentthinker->next->prev = currentthinker->prev;
-	    currentthinker->prev->next = currentthinker->next;
-	    Z_Free (currentthinker);
-	}
-	else
-	{
-	    if (currentthinker->function.acp1)
-		currentthinker->function.acp1 (currentthinker);
-	}
+	RunThinker (currentthinker);
 	currentthinker = currentthinker->next;
     }
 }
@@ -142,8 +332,12 @@ void P_Ticker (void)
 	if (playeringame[i])
 	    P_PlayerThink (&players[i]);
 			
+    PROFILE_BEGIN ("P_RunThinkers");
     P_RunThinkers ();
+    PROFILE_END ();
+    PROFILE_BEGIN ("P_UpdateSpecials");
     P_UpdateSpecials ();
+    PROFILE_END ();
     P_RespawnSpecials ();
 
     // for par times
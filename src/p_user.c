@@ -230,6 +230,11 @@ void P_PlayerThink (player_t* player)
 {
     ticcmd_t*		cmd;
     weapontype_t	newweapon;
+
+    // SOKOL CHANGE: where the tic starts, before the player turns
+    if (player->mo->oldgametic != gametic)
+	P_SetOldPosition (player->mo);
+    player->oldviewz = player->viewz;
 	
     // fixme: do this in the cheat code
     if (player->cheats & CF_NOCLIP)
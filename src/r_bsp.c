@@ -19,11 +19,14 @@
 
 
 
+#include <string.h>
+
 #include "doomdef.h"
 
 #include "m_bbox.h"
 
 #include "i_system.h"
+#include "z_zone.h"
 
 #include "r_main.h"
 #include "r_plane.h"
@@ -43,8 +46,11 @@ line_t*		linedef;
 sector_t*	frontsector;
 sector_t*	backsector;
 
-drawseg_t	drawsegs[MAXDRAWSEGS];
+// SOKOL CHANGE: drawsegs[] grows as needed instead of dropping the
+//  walls that do not fit, it keeps its size from frame to frame.
+drawseg_t*	drawsegs;
 drawseg_t*	ds_p;
+int		maxdrawsegs;
 
 
 void
@@ -55,11 +61,40 @@ R_StoreWallRange
 
 
 
+//
+// R_GrowDrawSegs
+// Doubles the size of drawsegs[].
+//
+void R_GrowDrawSegs (void)
+{
+    drawseg_t*	newdrawsegs;
+    int		used;
+
+    used = ds_p - drawsegs;
+    maxdrawsegs = maxdrawsegs ? maxdrawsegs * 2 : MAXDRAWSEGS;
+    newdrawsegs = Z_Malloc (maxdrawsegs * sizeof(*newdrawsegs),
+			    PU_STATIC, NULL);
+
+    if (drawsegs != NULL)
+    {
+	memcpy (newdrawsegs, drawsegs, used * sizeof(*drawsegs));
+	Z_Free (drawsegs);
+    }
+
+    drawsegs = newdrawsegs;
+    ds_p = drawsegs + used;
+}
+
+
+
 //
 // R_ClearDrawSegs
 //
 void R_ClearDrawSegs (void)
 {
+    if (drawsegs == NULL)
+	R_GrowDrawSegs ();
+
     ds_p = drawsegs;
 }
 
@@ -78,11 +113,38 @@ typedef	struct
 } cliprange_t;
 
 
+// SOKOL CHANGE: initial size, solidsegs[] grows as needed
 #define MAXSEGS		32
 
 // newend is one past the last valid seg
 cliprange_t*	newend;
-cliprange_t	solidsegs[MAXSEGS];
+cliprange_t*	solidsegs;
+static int	maxsolidsegs;
+
+
+//
+// GrowSolidSegs
+// Doubles the size of solidsegs[].
+//
+static void GrowSolidSegs (void)
+{
+    cliprange_t*	newsolidsegs;
+    int			used;
+
+    used = newend - solidsegs;
+    maxsolidsegs = maxsolidsegs ? maxsolidsegs * 2 : MAXSEGS;
+    newsolidsegs = Z_Malloc (maxsolidsegs * sizeof(*newsolidsegs),
+			     PU_STATIC, NULL);
+
+    if (solidsegs != NULL)
+    {
+	memcpy (newsolidsegs, solidsegs, used * sizeof(*solidsegs));
+	Z_Free (solidsegs);
+    }
+
+    solidsegs = newsolidsegs;
+    newend = solidsegs + used;
+}
 
 
 
@@ -101,6 +163,11 @@ R_ClipSolidWallSegment
     cliprange_t*	next;
     cliprange_t*	start;
 
+    // SOKOL CHANGE: room for the post this may insert, vanilla
+    //  overflowed here with too many gaps in the view.
+    if (newend == solidsegs + maxsolidsegs)
+	GrowSolidSegs ();
+
     // Find the first range that touches the range
     //  (adjacent pixels are touching).
     start = solidsegs;
@@ -116,6 +183,9 @@ R_ClipSolidWallSegment
 	    R_StoreWallRange (first, last);
 	    next = newend;
 	    newend++;
+
+	    if (newend - solidsegs > highwater.solidsegs)
+		highwater.solidsegs = newend - solidsegs;
 	    
 	    while (next != start)
 	    {
@@ -237,6 +307,9 @@ R_ClipPassWallSegment
 //
 void R_ClearClipSegs (void)
 {
+    if (solidsegs == NULL)
+	GrowSolidSegs ();
+
     solidsegs[0].first = -0x7fffffff;
     solidsegs[0].last = -1;
     solidsegs[1].first = viewwidth;
@@ -542,32 +615,56 @@ void R_Subsector (int num)
 // Renders all subsectors below a given node,
 //  traversing subtree recursively.
 // Just call with BSP root.
+// SOKOL CHANGE: walks the depth first node arrays with a stack of the
+//  back spaces still to divide, bspnum is a position in them.
+static int*	bspstack;
+
 void R_RenderBSPNode (int bspnum)
 {
-    node_t*	bsp;
     int		side;
+    int		count;
+    int		num;
 
-    // Found a subsector?
-    if (bspnum & NF_SUBSECTOR)
+    if (!bspstack)
+	bspstack = Z_Malloc ((bspdepth+1)*sizeof(*bspstack), PU_LEVEL,
+			     &bspstack);
+
+    count = 0;
+
+    for (;;)
     {
-	if (bspnum == -1)			
-	    R_Subsector (0);
-	else
+	// Found a subsector?
+	if (bspnum & NF_SUBSECTOR)
+	{
 	    R_Subsector (bspnum&(~NF_SUBSECTOR));
-	return;
-    }
-		
-    bsp = &nodes[bspnum];
-    
-    // Decide which side the view point is on.
-    side = R_PointOnSide (viewx, viewy, bsp);
+	}
+	else
+	{
+	    // Decide which side the view point is on.
+	    side = R_PointOnPartitionSide (viewx, viewy,
+					   bspx[bspnum], bspy[bspnum],
+					   bspdx[bspnum], bspdy[bspnum]);
 
-    // Recursively divide front space.
-    R_RenderBSPNode (bsp->children[side]); 
+	    // The back space is looked at when the front is done.
+	    bspstack[count++] = (bspnum << 1) | (side^1);
 
-    // Possibly divide back space.
-    if (R_CheckBBox (bsp->bbox[side^1]))	
-	R_RenderBSPNode (bsp->children[side^1]);
+	    // Divide front space.
+	    bspnum = bspchildren[side][bspnum];
+	    continue;
+	}
+
+	// Possibly divide the back space put off last.
+	do
+	{
+	    if (!count)
+		return;
+
+	    num = bspstack[--count] >> 1;
+	    side = bspstack[count] & 1;
+	} while (!R_CheckBBox (bspbbox[num][side]));
+
+	bspnum = bspchildren[side][num];
+    }
 }
 
 
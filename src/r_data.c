@@ -22,6 +22,7 @@
 #include "deh_main.h"
 #include "i_swap.h"
 #include "i_system.h"
+#include "i_thread.h"
 #include "z_zone.h"
 
 
@@ -151,6 +152,15 @@ short**			texturecolumnlump;
 unsigned short**	texturecolumnofs;
 byte**			texturecomposite;
 
+// SOKOL CHANGE: the column pointers of every texture drawn this level,
+//  NULL until R_ResolveColumns. They and the data they point to are
+//  freed with the level.
+byte***			texturecolumns;
+
+// Copies of the patches of texturecolumns, if the WAD is not mapped
+//  and the lump cache could move or purge them.
+static byte**		pinnedlumps;
+
 // for global animation
 int*		flattranslation;
 int*		texturetranslation;
@@ -223,7 +233,9 @@ R_DrawColumnInCache
 //  the composite texture is created from the patches,
 //  and each column is cached.
 //
-void R_GenerateComposite (int texnum)
+// SOKOL CHANGE: draws the patches into the allocated composite,
+//  on the render threads if the patches are memory mapped.
+static void ComposePatches (int texnum)
 {
     byte*		block;
     texture_t*		texture;
@@ -238,10 +250,7 @@ void R_GenerateComposite (int texnum)
     unsigned short*	colofs;
 	
     texture = textures[texnum];
-
-    block = Z_Malloc (texturecompositesize[texnum],
-		      PU_STATIC, 
-		      &texturecomposite[texnum]);	
+    block = texturecomposite[texnum];
 
     collump = texturecolumnlump[texnum];
     colofs = texturecolumnofs[texnum];
@@ -280,10 +289,21 @@ void R_GenerateComposite (int texnum)
 	}
 						
     }
+}
 
-    // Now that the texture has been built in column cache,
-    //  it is purgable from zone memory.
-    Z_ChangeTag (block, PU_CACHE);
+
+
+void R_GenerateComposite (int texnum)
+{
+    // SOKOL CHANGE: kept for the level, see R_ResolveColumns,
+    //  and padded, see LUMPPADDING.
+    Z_Malloc (texturecompositesize[texnum] + LUMPPADDING,
+	      PU_LEVEL, 
+	      &texturecomposite[texnum]);	
+    memset (texturecomposite[texnum] + texturecompositesize[texnum],
+	    0, LUMPPADDING);
+
+    ComposePatches (texnum);
 }
 
 
@@ -376,6 +396,62 @@ void R_GenerateLookup (int texnum)
 
 
 
+//
+// PinLump
+// SOKOL CHANGE: a lump which stays put until the level is freed.
+//
+static byte* PinLump (int lump)
+{
+    if (lumpinfo[lump].wad_file->mapped != NULL)
+	return W_CacheLumpNum (lump, PU_CACHE);
+
+    if (!pinnedlumps[lump])
+    {
+	Z_Malloc (W_LumpLength (lump) + LUMPPADDING, PU_LEVEL,
+		  &pinnedlumps[lump]);
+	W_ReadLump (lump, pinnedlumps[lump]);
+	memset (pinnedlumps[lump] + W_LumpLength (lump), 0, LUMPPADDING);
+    }
+
+    return pinnedlumps[lump];
+}
+
+
+//
+// R_ResolveColumns
+// SOKOL CHANGE: looks up every column of a texture once, rather
+//  than the lump cache for every column drawn.
+//
+static byte** R_ResolveColumns (int tex)
+{
+    texture_t*		texture;
+    short*		collump;
+    unsigned short*	colofs;
+    byte**		columns;
+    int			x;
+
+    texture = textures[tex];
+    collump = texturecolumnlump[tex];
+    colofs = texturecolumnofs[tex];
+
+    if (texturecompositesize[tex] && !texturecomposite[tex])
+	R_GenerateComposite (tex);
+
+    columns = Z_Malloc (texture->width * sizeof(*columns),
+			PU_LEVEL, &texturecolumns[tex]);
+
+    for (x=0 ; x<texture->width ; x++)
+    {
+	if (collump[x] > 0)
+	    columns[x] = PinLump (collump[x]) + colofs[x];
+	else
+	    columns[x] = texturecomposite[tex] + colofs[x];
+    }
+
+    return columns;
+}
+
+
 //
 // R_GetColumn
 //
@@ -384,20 +460,45 @@ R_GetColumn
 ( int		tex,
   int		col )
 {
-    int		lump;
-    int		ofs;
-	
-    col &= texturewidthmask[tex];
-    lump = texturecolumnlump[tex][col];
-    ofs = texturecolumnofs[tex][col];
-    
-    if (lump > 0)
-	return (byte *)W_CacheLumpNum(lump,PU_CACHE)+ofs;
+    byte**	columns;
 
-    if (!texturecomposite[tex])
-	R_GenerateComposite (tex);
+    // SOKOL CHANGE: resolved at level load, or the first time drawn
+    columns = texturecolumns[tex];
+
+    if (!columns)
+	columns = R_ResolveColumns (tex);
+
+    return columns[col & texturewidthmask[tex]];
+}
+
+
+//
+// R_ColumnsFitLump
+// SOKOL CHANGE: the column drawers read 128 texels whatever the
+//  height of the texture, past the end of a short column.
+//
+boolean R_ColumnsFitLump (int tex, int length)
+{
+    short*		collump;
+    unsigned short*	colofs;
+    int			size;
+    int			x;
+
+    collump = texturecolumnlump[tex];
+    colofs = texturecolumnofs[tex];
+
+    for (x=0 ; x<=texturewidthmask[tex] ; x++)
+    {
+	if (collump[x] > 0)
+	    size = W_LumpLength (collump[x]);
+	else
+	    size = texturecompositesize[tex];
 
-    return texturecomposite[tex] + ofs;
+	if (size - colofs[x] < length)
+	    return false;
+    }
+
+    return true;
 }
 
 
@@ -526,6 +627,10 @@ void R_InitTextures (void)
     texturecompositesize = Z_Malloc (numtextures * sizeof(*texturecompositesize), PU_STATIC, 0);
     texturewidthmask = Z_Malloc (numtextures * sizeof(*texturewidthmask), PU_STATIC, 0);
     textureheight = Z_Malloc (numtextures * sizeof(*textureheight), PU_STATIC, 0);
+    texturecolumns = Z_Malloc (numtextures * sizeof(*texturecolumns), PU_STATIC, 0);
+    memset (texturecolumns, 0, numtextures * sizeof(*texturecolumns));
+    pinnedlumps = Z_Malloc (numlumps * sizeof(*pinnedlumps), PU_STATIC, 0);
+    memset (pinnedlumps, 0, numlumps * sizeof(*pinnedlumps));
 
     totalwidth = 0;
     
@@ -789,6 +894,114 @@ int	R_TextureNumForName (char* name)
 
 
 
+// SOKOL CHANGE: work handed to the render threads at level load,
+//  the zone is only touched before and after.
+
+static int*		jobtextures;
+static int*		joblumps;
+
+static void ComposeJob (int job)
+{
+    ComposePatches (jobtextures[job]);
+}
+
+static boolean PatchesMapped (int tex)
+{
+    texture_t*		texture;
+    int			i;
+
+    texture = textures[tex];
+
+    for (i=0 ; i<texture->patchcount ; i++)
+    {
+	if (!lumpinfo[texture->patches[i].patch].wad_file->mapped)
+	    return false;
+    }
+
+    return true;
+}
+
+// Adds a texture of the level, once.
+
+static int AddLevelTexture (int* list, int count, int tex)
+{
+    int			i;
+
+    if (texturecolumns[tex])
+	return count;
+
+    for (i=0 ; i<count ; i++)
+    {
+	if (list[i] == tex)
+	    return count;
+    }
+
+    list[count] = tex;
+    return count + 1;
+}
+
+
+//
+// R_ResolveLevelColumns
+// SOKOL CHANGE: resolves the textures of the sidedefs and the sky,
+//  animated and switched textures are resolved when first drawn.
+//  The composites are built on the render threads.
+//
+void R_ResolveLevelColumns (void)
+{
+    int*		list;
+    int			count;
+    int			numjobs;
+    int			tex;
+    int			i;
+
+    list = Z_Malloc (numtextures * sizeof(*list), PU_STATIC, NULL);
+    jobtextures = Z_Malloc (numtextures * sizeof(*jobtextures),
+			    PU_STATIC, NULL);
+    count = 0;
+
+    for (i=0 ; i<numsides ; i++)
+    {
+	count = AddLevelTexture (list, count, sides[i].toptexture);
+	count = AddLevelTexture (list, count, sides[i].midtexture);
+	count = AddLevelTexture (list, count, sides[i].bottomtexture);
+    }
+
+    count = AddLevelTexture (list, count, skytexture);
+
+    // Allocate here, the zone is not thread safe. Patches which
+    //  are not mapped are read into the zone as well.
+    numjobs = 0;
+
+    for (i=0 ; i<count ; i++)
+    {
+	tex = list[i];
+
+	if (!texturecompositesize[tex] || texturecomposite[tex])
+	    continue;
+
+	if (PatchesMapped (tex))
+	{
+	    Z_Malloc (texturecompositesize[tex], PU_LEVEL,
+		      &texturecomposite[tex]);
+	    jobtextures[numjobs++] = tex;
+	}
+	else
+	{
+	    R_GenerateComposite (tex);
+	}
+    }
+
+    I_RunThreads (ComposeJob, numjobs);
+
+    for (i=0 ; i<count ; i++)
+	R_ResolveColumns (list[i]);
+
+    Z_Free (jobtextures);
+    Z_Free (list);
+}
+
+
 //
 // R_PrecacheLevel
 // Preloads all relevant graphics for the level.
@@ -797,6 +1010,38 @@ int		flatmemory;
 int		texturememory;
 int		spritememory;
 
+// SOKOL CHANGE: mapped lumps are paged in by the render threads,
+//  the others are read into the cache right away.
+
+static int	numjoblumps;
+static byte*	lumpqueued;
+
+static void PrecacheLump (int lump)
+{
+    if (!lumpinfo[lump].wad_file->mapped)
+	W_CacheLumpNum (lump, PU_CACHE);
+    else if (!lumpqueued[lump])
+    {
+	lumpqueued[lump] = 1;
+	joblumps[numjoblumps++] = lump;
+    }
+}
+
+static void PageInJob (int job)
+{
+    byte*		data;
+    int			size;
+    int			i;
+    volatile byte	sum;
+
+    data = W_CacheLumpNum (joblumps[job], PU_CACHE);
+    size = W_LumpLength (joblumps[job]);
+    sum = 0;
+
+    for (i=0 ; i<size ; i+=4096)
+	sum += data[i];
+}
+
 void R_PrecacheLevel (void)
 {
     char*		flatpresent;
@@ -814,6 +1059,12 @@ void R_PrecacheLevel (void)
 
     if (demoplayback)
 	return;
+
+    // SOKOL CHANGE: one job per lump
+    joblumps = Z_Malloc (numlumps * sizeof(*joblumps), PU_STATIC, NULL);
+    lumpqueued = Z_Malloc (numlumps, PU_STATIC, NULL);
+    memset (lumpqueued, 0, numlumps);
+    numjoblumps = 0;
     
     // Precache flats.
     flatpresent = Z_Malloc(numflats, PU_STATIC, NULL);
@@ -833,7 +1084,7 @@ void R_PrecacheLevel (void)
 	{
 	    lump = firstflat + i;
 	    flatmemory += lumpinfo[lump].size;
-	    W_CacheLumpNum(lump, PU_CACHE);
+	    PrecacheLump (lump);
 	}
     }
 
@@ -870,7 +1121,7 @@ void R_PrecacheLevel (void)
 	{
 	    lump = texture->patches[j].patch;
 	    texturememory += lumpinfo[lump].size;
-	    W_CacheLumpNum(lump , PU_CACHE);
+	    PrecacheLump (lump);
 	}
     }
 
@@ -899,12 +1150,17 @@ void R_PrecacheLevel (void)
 	    {
 		lump = firstspritelump + sf->lump[k];
 		spritememory += lumpinfo[lump].size;
-		W_CacheLumpNum(lump , PU_CACHE);
+		PrecacheLump (lump);
 	    }
 	}
     }
 
     Z_Free(spritepresent);
+
+    I_RunThreads (PageInJob, numjoblumps);
+
+    Z_Free (lumpqueued);
+    Z_Free (joblumps);
 }
 
 
@@ -36,6 +36,17 @@ R_GetColumn
 void R_InitData (void);
 void R_PrecacheLevel (void);
 
+// Looks up the columns of the level's textures, after the
+//  previous level was freed.
+void R_ResolveLevelColumns (void);
+
+// SOKOL CHANGE: whether every column of a texture has length bytes
+//  to read, within its patch or composite.
+boolean R_ColumnsFitLump (int tex, int length);
+
+extern int		numtextures;
+extern int*		texturewidthmask;
+
 
 // Retrieval.
 // Floor/ceiling opaque texture tiles,
@@ -48,6 +48,7 @@
 #define SIL_TOP			2
 #define SIL_BOTH		3
 
+// SOKOL CHANGE: initial size, drawsegs[] grows as needed
 #define MAXDRAWSEGS		256
 
 
@@ -127,6 +128,16 @@ typedef	struct
 
     int			linecount;
     struct line_s**	lines;	// [linecount] size
+
+    // SOKOL CHANGE: the heights before the last tic the sector moved
+    //  in, display frames between tics are drawn in between.
+    fixed_t	oldfloorheight;
+    fixed_t	oldceilingheight;
+    int		oldgametic;
+
+    // The heights of the tic while such a frame is drawn.
+    fixed_t	ticfloorheight;
+    fixed_t	ticceilingheight;
     
 } sector_t;
 
@@ -337,9 +348,8 @@ typedef struct drawseg_s
 // I.e. a sprite object that is partly visible.
 typedef struct vissprite_s
 {
-    // Doubly linked list.
-    struct vissprite_s*	prev;
-    struct vissprite_s*	next;
+    // SOKOL CHANGE: no longer a linked list, R_SortVisSprites
+    //  sorts an array of pointers instead.
     
     int			x1;
     int			x2;
@@ -420,25 +430,22 @@ typedef struct
 //
 // Now what is a visplane, anyway?
 // 
-typedef struct
+typedef struct visplane_s
 {
+  // SOKOL CHANGE: next in the hash chain
+  struct visplane_s*	next;
+
   fixed_t		height;
   int			picnum;
   int			lightlevel;
   int			minx;
   int			maxx;
   
-  // leave pads for [minx-1]/[maxx+1]
-  
-  byte		pad1;
-  // Here lies the rub for all
-  //  dynamic resize/change of resolution.
-  byte		top[SCREENWIDTH];
-  byte		pad2;
-  byte		pad3;
-  // See above.
-  byte		bottom[SCREENWIDTH];
-  byte		pad4;
+  // SOKOL CHANGE: SCREENWIDTH entries each, allocated with the
+  //  visplane and padded for [minx-1]/[maxx+1]. Wide enough for
+  //  rows past 255, 0xffff marks an empty column.
+  unsigned short*	top;
+  unsigned short*	bottom;
 
 } visplane_t;
 
@@ -20,11 +20,14 @@
 
 
 
+#include <string.h>
 
 #include "doomdef.h"
 #include "deh_main.h"
 
 #include "i_system.h"
+#include "i_thread.h"
+#include "m_argv.h"
 #include "z_zone.h"
 #include "w_wad.h"
 
@@ -37,12 +40,8 @@
 #include "doomstat.h"
 
 
-// ?
-#define MAXWIDTH			1120
-#define MAXHEIGHT			832
-
 // status bar height at bottom of screen
-#define SBARHEIGHT		32
+#define SBARHEIGHT		(32*screenscale)
 
 //
 // All drawing to the view buffer is accomplished in this file.
@@ -60,8 +59,19 @@ int		scaledviewwidth;
 int		viewheight;
 int		viewwindowx;
 int		viewwindowy; 
-byte*		ylookup[MAXHEIGHT]; 
-int		columnofs[MAXWIDTH]; 
+// SOKOL CHANGE: allocated for the render resolution
+byte**		ylookup; 
+int*		columnofs; 
+
+// SOKOL CHANGE: the step to the next pixel down a column and
+//  along a span. With -colmajor the view is drawn into viewbuffer
+//  column by column, so that the column drawers write to memory in
+//  order, and R_TransposeView copies it to the screen.
+int		dc_pitch;
+int		ds_pitch;
+boolean		colmajor;
+
+static byte*	viewbuffer;
 
 // Color tables for different players,
 //  translate a limited part to another
@@ -79,15 +89,18 @@ static byte *background_buffer = NULL;
 // R_DrawColumn
 // Source is the top of the column to scale.
 //
-lighttable_t*		dc_colormap; 
-int			dc_x; 
-int			dc_yl; 
-int			dc_yh; 
-fixed_t			dc_iscale; 
-fixed_t			dc_texturemid;
+// SOKOL CHANGE: the dc_ and ds_ state is thread local, the render
+// threads draw queued columns and spans with it (r_strip.c).
+//
+THREADLOCAL lighttable_t*		dc_colormap; 
+THREADLOCAL int			dc_x; 
+THREADLOCAL int			dc_yl; 
+THREADLOCAL int			dc_yh; 
+THREADLOCAL fixed_t			dc_iscale; 
+THREADLOCAL fixed_t			dc_texturemid;
 
 // first pixel in a column (possibly virtual) 
-byte*			dc_source;		
+THREADLOCAL byte*			dc_source;		
 
 // just for profiling 
 int			dccount;
@@ -138,7 +151,7 @@ void R_DrawColumn (void)
 	//  using a lighting/special effects LUT.
 	*dest = dc_colormap[dc_source[(frac>>FRACBITS)&127]];
 	
-	dest += SCREENWIDTH; 
+	dest += dc_pitch; 
 	frac += fracstep;
 	
     } while (count--); 
@@ -243,8 +256,8 @@ void R_DrawColumnLow (void)
     {
 	// Hack. Does not work corretly.
 	*dest2 = *dest = dc_colormap[dc_source[(frac>>FRACBITS)&127]];
-	dest += SCREENWIDTH;
-	dest2 += SCREENWIDTH;
+	dest += dc_pitch;
+	dest2 += dc_pitch;
 	frac += fracstep; 
 
     } while (count--);
@@ -254,8 +267,8 @@ void R_DrawColumnLow (void)
 //
 // Spectre/Invisibility.
 //
-#define FUZZTABLE		50 
-#define FUZZOFF	(SCREENWIDTH)
+// SOKOL CHANGE: in rows, multiplied by dc_pitch when used
+#define FUZZOFF	(1)
 
 
 int	fuzzoffset[FUZZTABLE] =
@@ -269,7 +282,7 @@ int	fuzzoffset[FUZZTABLE] =
     FUZZOFF,FUZZOFF,-FUZZOFF,FUZZOFF,FUZZOFF,-FUZZOFF,FUZZOFF 
 }; 
 
-int	fuzzpos = 0; 
+THREADLOCAL int	fuzzpos = 0; 
 
 
 //
@@ -325,13 +338,13 @@ void R_DrawFuzzColumn (void)
 	//  a pixel that is either one column
 	//  left or right of the current one.
 	// Add index from colormap to index.
-	*dest = colormaps[6*256+dest[fuzzoffset[fuzzpos]]]; 
+	*dest = colormaps[6*256+dest[fuzzoffset[fuzzpos]*dc_pitch]]; 
 
 	// Clamp table lookup index.
 	if (++fuzzpos == FUZZTABLE) 
 	    fuzzpos = 0;
 	
-	dest += SCREENWIDTH;
+	dest += dc_pitch;
 
 	frac += fracstep; 
     } while (count--); 
@@ -391,15 +404,15 @@ void R_DrawFuzzColumnLow (void)
 	//  a pixel that is either one column
 	//  left or right of the current one.
 	// Add index from colormap to index.
-	*dest = colormaps[6*256+dest[fuzzoffset[fuzzpos]]]; 
-	*dest2 = colormaps[6*256+dest2[fuzzoffset[fuzzpos]]]; 
+	*dest = colormaps[6*256+dest[fuzzoffset[fuzzpos]*dc_pitch]]; 
+	*dest2 = colormaps[6*256+dest2[fuzzoffset[fuzzpos]*dc_pitch]]; 
 
 	// Clamp table lookup index.
 	if (++fuzzpos == FUZZTABLE) 
 	    fuzzpos = 0;
 	
-	dest += SCREENWIDTH;
-	dest2 += SCREENWIDTH;
+	dest += dc_pitch;
+	dest2 += dc_pitch;
 
 	frac += fracstep; 
     } while (count--); 
@@ -418,7 +431,7 @@ void R_DrawFuzzColumnLow (void)
 //  of the BaronOfHell, the HellKnight, uses
 //  identical sprites, kinda brightened up.
 //
-byte*	dc_translation;
+THREADLOCAL byte*	dc_translation;
 byte*	translationtables;
 
 void R_DrawTranslatedColumn (void) 
@@ -459,7 +472,7 @@ void R_DrawTranslatedColumn (void)
 	// Thus the "green" ramp of the player 0 sprite
 	//  is mapped to gray, red, black/indigo. 
 	*dest = dc_colormap[dc_translation[dc_source[frac>>FRACBITS]]];
-	dest += SCREENWIDTH;
+	dest += dc_pitch;
 	
 	frac += fracstep; 
     } while (count--); 
@@ -510,8 +523,8 @@ void R_DrawTranslatedColumnLow (void)
 	//  is mapped to gray, red, black/indigo. 
 	*dest = dc_colormap[dc_translation[dc_source[frac>>FRACBITS]]];
 	*dest2 = dc_colormap[dc_translation[dc_source[frac>>FRACBITS]]];
-	dest += SCREENWIDTH;
-	dest2 += SCREENWIDTH;
+	dest += dc_pitch;
+	dest2 += dc_pitch;
 	
 	frac += fracstep; 
     } while (count--); 
@@ -567,19 +580,26 @@ void R_InitTranslationTables (void)
 // In consequence, flats are not stored by column (like walls),
 //  and the inner loop has to step in texture space u and v.
 //
-int			ds_y; 
-int			ds_x1; 
-int			ds_x2;
+THREADLOCAL int			ds_y; 
+THREADLOCAL int			ds_x1; 
+THREADLOCAL int			ds_x2;
 
-lighttable_t*		ds_colormap; 
+THREADLOCAL lighttable_t*		ds_colormap; 
 
-fixed_t			ds_xfrac; 
-fixed_t			ds_yfrac; 
-fixed_t			ds_xstep; 
-fixed_t			ds_ystep;
+THREADLOCAL fixed_t			ds_xfrac; 
+THREADLOCAL fixed_t			ds_yfrac; 
+THREADLOCAL fixed_t			ds_xstep; 
+THREADLOCAL fixed_t			ds_ystep;
 
 // start of a 64*64 tile image 
-byte*			ds_source;	
+THREADLOCAL byte*			ds_source;	
+
+// SOKOL CHANGE: the span each row of a flat is in, for the flats
+//  drawn column by column with -colmajor. Packed as in R_DrawSpan,
+//  the colormap as an offset into colormaps.
+unsigned int*		ds_rowposition;
+unsigned int*		ds_rowstep;
+int*			ds_rowlight;
 
 // just for profiling
 int			dscount;
@@ -631,7 +651,8 @@ void R_DrawSpan (void)
 
 	// Lookup pixel from flat texture tile,
 	//  re-index using light/colormap.
-	*dest++ = ds_colormap[ds_source[spot]];
+	*dest = ds_colormap[ds_source[spot]];
+	dest += ds_pitch;
 
         position += step;
 
@@ -758,14 +779,79 @@ void R_DrawSpanLow (void)
 
 	// Lowres/blocky mode does it twice,
 	//  while scale is adjusted appropriately.
-	*dest++ = ds_colormap[ds_source[spot]];
-	*dest++ = ds_colormap[ds_source[spot]];
+	*dest = ds_colormap[ds_source[spot]];
+	dest += ds_pitch;
+	*dest = ds_colormap[ds_source[spot]];
+	dest += ds_pitch;
 
 	position += step;
 
     } while (count--);
 }
 
+//
+// R_DrawPlaneColumn
+// SOKOL CHANGE: a column of a flat, for -colmajor. Each row moves
+//  one pixel along its span, see ds_rowposition.
+//
+void R_DrawPlaneColumn (void)
+{
+    unsigned int *rowposition;
+    unsigned int *rowstep;
+    int *rowlight;
+    byte *colormap;
+    unsigned int position;
+    byte *source;
+    byte *dest;
+    int y;
+
+#ifdef RANGECHECK
+    if ((unsigned)dc_x >= SCREENWIDTH
+	|| dc_yl < 0
+	|| dc_yh >= SCREENHEIGHT)
+    {
+	I_Error ("R_DrawPlaneColumn: %i to %i at %i", dc_yl, dc_yh, dc_x);
+    }
+#endif
+
+    // Locals, as the pixel stores might alias the globals.
+    rowposition = ds_rowposition;
+    rowstep = ds_rowstep;
+    rowlight = ds_rowlight;
+    colormap = colormaps;
+    source = ds_source;
+    dest = ylookup[dc_yl] + columnofs[dc_x];
+
+    for (y = dc_yl; y <= dc_yh; y++)
+    {
+	position = rowposition[y];
+	rowposition[y] = position + rowstep[y];
+
+	*dest++ = colormap[rowlight[y]
+			   + source[((position >> 4) & 0x0fc0)
+				    | (position >> 26)]];
+    }
+}
+
+
+//
+// Again..
+//
+void R_DrawPlaneColumnLow (void)
+{
+    int x;
+
+    // Blocky mode, the column twice.
+    x = dc_x;
+    dc_x <<= 1;
+    R_DrawPlaneColumn ();
+
+    memcpy (ylookup[dc_yl] + columnofs[dc_x + 1],
+	    ylookup[dc_yl] + columnofs[dc_x], dc_yh - dc_yl + 1);
+    dc_x = x;
+}
+
+
 //
 // R_InitBuffer 
 // Creats lookup tables that avoid
@@ -785,24 +871,215 @@ R_InitBuffer
     //  with border and/or status bar.
     viewwindowx = (SCREENWIDTH-width) >> 1; 
 
-    // Column offset. For windows.
-    for (i=0 ; i<width ; i++) 
-	columnofs[i] = viewwindowx + i;
-
     // Samw with base row offset.
     if (width == SCREENWIDTH) 
 	viewwindowy = 0; 
     else 
 	viewwindowy = (SCREENHEIGHT-SBARHEIGHT-height) >> 1; 
 
+    // SOKOL CHANGE: columns one after another in the view buffer
+    if (colmajor)
+    {
+	for (i=0 ; i<width ; i++) 
+	    columnofs[i] = i*height;
+
+	for (i=0 ; i<height ; i++) 
+	    ylookup[i] = viewbuffer + i; 
+
+	dc_pitch = 1;
+	ds_pitch = height;
+	return;
+    }
+
+    // Column offset. For windows.
+    for (i=0 ; i<width ; i++) 
+	columnofs[i] = viewwindowx + i;
+
     // Preclaculate all row offsets.
     for (i=0 ; i<height ; i++) 
 	ylookup[i] = I_VideoBuffer + (i+viewwindowy)*SCREENWIDTH; 
+
+    dc_pitch = SCREENWIDTH;
+    ds_pitch = 1;
 } 
+
+
+//
+// R_InitViewBuffer
+// SOKOL CHANGE: the lookup tables for the render resolution,
+//  and the column-major view buffer if asked for.
+//
+void R_InitViewBuffer (void)
+{
+    ylookup = Z_Malloc (SCREENHEIGHT * sizeof(*ylookup), PU_STATIC, NULL);
+    columnofs = Z_Malloc (SCREENWIDTH * sizeof(*columnofs), PU_STATIC, NULL);
+
+    //!
+    // @category video
+    //
+    // Draw the view column by column into a separate buffer and copy
+    // it to the screen when done, so that the walls and sprites, and
+    // the floors and ceilings unless queued by -rthreads, are drawn
+    // to memory in order. The picture is the same.
+    //
+
+    colmajor = M_CheckParm ("-colmajor") > 0;
+
+    if (colmajor)
+    {
+	viewbuffer = Z_Malloc (SCREENWIDTH*SCREENHEIGHT, PU_STATIC, NULL);
+
+	ds_rowposition = Z_Malloc (SCREENHEIGHT * sizeof(*ds_rowposition),
+				   PU_STATIC, NULL);
+	ds_rowstep = Z_Malloc (SCREENHEIGHT * sizeof(*ds_rowstep),
+			       PU_STATIC, NULL);
+	ds_rowlight = Z_Malloc (SCREENHEIGHT * sizeof(*ds_rowlight),
+				PU_STATIC, NULL);
+    }
+}
+
+
+//
+// R_TransposeView
+// SOKOL CHANGE: copies the column-major view buffer to the screen
+//  in blocks, so that both the reads and the writes stay in a few
+//  cache lines at a time.
+//
+#define TRANSPOSEBLOCK	32
+
+// Transposes an 8x8 tile with 64-bit words, swapping ever larger
+// sub-blocks: bytes, then pairs, then quads. Little endian, which
+// is all this port builds for.
+
+static void Transpose8x8 (byte* src, byte* dest)
+{
+    uint64_t	a[8];
+    uint64_t	t;
+    int		i;
+
+    for (i=0 ; i<8 ; i++)
+	memcpy (&a[i], src + i*viewheight, 8);
+
+    for (i=0 ; i<8 ; i+=2)
+    {
+	t = ((a[i] >> 8) ^ a[i+1]) & 0x00ff00ff00ff00ffULL;
+	a[i+1] ^= t;
+	a[i] ^= t << 8;
+    }
+
+    for (i=0 ; i<8 ; i += (i&1) ? 3 : 1)
+    {
+	t = ((a[i] >> 16) ^ a[i+2]) & 0x0000ffff0000ffffULL;
+	a[i+2] ^= t;
+	a[i] ^= t << 16;
+    }
+
+    for (i=0 ; i<4 ; i++)
+    {
+	t = ((a[i] >> 32) ^ a[i+4]) & 0x00000000ffffffffULL;
+	a[i+4] ^= t;
+	a[i] ^= t << 32;
+    }
+
+    for (i=0 ; i<8 ; i++)
+	memcpy (dest + i*SCREENWIDTH, &a[i], 8);
+}
+
+// One row of blocks, run by the render threads.
+
+static void TransposeBlockRow (int row)
+{
+    byte*	src;
+    byte*	dest;
+    int		x;
+    int		y;
+    int		x1;
+    int		x2;
+    int		y1;
+    int		y2;
+    int		ytiles;
+
+    y1 = row * TRANSPOSEBLOCK;
+    y2 = y1 + TRANSPOSEBLOCK;
+
+    if (y2 > viewheight)
+	y2 = viewheight;
+
+    ytiles = y1 + ((y2 - y1) & ~7);
+
+    for (x1=0 ; x1<scaledviewwidth ; x1+=TRANSPOSEBLOCK)
+    {
+	x2 = x1 + TRANSPOSEBLOCK;
+
+	if (x2 > scaledviewwidth)
+	    x2 = scaledviewwidth;
+
+	// Whole tiles first, then the ragged right and bottom edges
+	// byte by byte.
+
+	for (x=x1 ; x+8<=x2 ; x+=8)
+	{
+	    for (y=y1 ; y<ytiles ; y+=8)
+	    {
+		Transpose8x8 (viewbuffer + x*viewheight + y,
+			      I_VideoBuffer + (viewwindowy+y)*SCREENWIDTH
+			      + viewwindowx + x);
+	    }
+	}
+
+	for (y=y1 ; y<y2 ; y++)
+	{
+	    if (y < ytiles)
+		x = x1 + ((x2 - x1) & ~7);
+	    else
+		x = x1;
+
+	    src = viewbuffer + x*viewheight + y;
+	    dest = I_VideoBuffer + (viewwindowy+y)*SCREENWIDTH
+		 + viewwindowx + x;
+
+	    for ( ; x<x2 ; x++)
+	    {
+		*dest++ = *src;
+		src += viewheight;
+	    }
+	}
+    }
+}
+
+void R_TransposeView (void)
+{
+    I_RunThreads (TransposeBlockRow,
+		  (viewheight + TRANSPOSEBLOCK - 1) / TRANSPOSEBLOCK);
+}
  
  
 
 
+//
+// R_BorderFlat
+// SOKOL CHANGE: the flat around a reduced view, also shown
+//  at the sides of the status bar on a wide screen.
+//
+byte* R_BorderFlat (void)
+{
+    // DOOM border patch.
+    char       *name1 = DEH_String("FLOOR7_2");
+
+    // DOOM II border patch.
+    char *name2 = DEH_String("GRNROCK");
+
+    char *name;
+
+    if (gamemode == commercial)
+	name = name2;
+    else
+	name = name1;
+    
+    return W_CacheLumpName(name, PU_CACHE); 
+}
+
+
 //
 // R_FillBackScreen
 // Fills the back screen with a pattern
@@ -812,19 +1089,14 @@ R_InitBuffer
 void R_FillBackScreen (void) 
 { 
     byte*	src;
-    byte*	dest; 
     int		x;
     int		y; 
+    int		left;
+    int		top;
+    int		width;
+    int		height;
     patch_t*	patch;
 
-    // DOOM border patch.
-    char       *name1 = DEH_String("FLOOR7_2");
-
-    // DOOM II border patch.
-    char *name2 = DEH_String("GRNROCK");
-
-    char *name;
-
     // If we are running full screen, there is no need to do any of this,
     // and the background buffer can be freed if it was previously in use.
 
@@ -847,65 +1119,55 @@ void R_FillBackScreen (void)
                                      PU_STATIC, NULL);
     }
 
-    if (gamemode == commercial)
-	name = name2;
-    else
-	name = name1;
-    
-    src = W_CacheLumpName(name, PU_CACHE); 
-    dest = background_buffer;
-	 
-    for (y=0 ; y<SCREENHEIGHT-SBARHEIGHT ; y++) 
-    { 
-	for (x=0 ; x<SCREENWIDTH/64 ; x++) 
-	{ 
-	    memcpy (dest, src+((y&63)<<6), 64); 
-	    dest += 64; 
-	} 
-
-	if (SCREENWIDTH&63) 
-	{ 
-	    memcpy (dest, src+((y&63)<<6), SCREENWIDTH&63); 
-	    dest += (SCREENWIDTH&63); 
-	} 
-    } 
+    src = R_BorderFlat ();
      
     // Draw screen and bezel; this is done to a separate screen buffer.
 
     V_UseBuffer(background_buffer);
 
+    // SOKOL CHANGE: scaled up with the rest of the border
+    V_FillFlat (0, 0, SCREENWIDTH, SCREENHEIGHT-SBARHEIGHT, src);
+
+    // SOKOL CHANGE: the patches are placed in 320x200 units,
+    //  V_DrawPatch centers them on a wide screen
+
+    left = viewwindowx / screenscale - widescreendelta;
+    top = viewwindowy / screenscale;
+    width = scaledviewwidth / screenscale;
+    height = viewheight / screenscale;
+
     patch = W_CacheLumpName(DEH_String("brdr_t"),PU_CACHE);
 
-    for (x=0 ; x<scaledviewwidth ; x+=8)
-	V_DrawPatch(viewwindowx+x, viewwindowy-8, patch);
+    for (x=0 ; x<width ; x+=8)
+	V_DrawPatch(left+x, top-8, patch);
     patch = W_CacheLumpName(DEH_String("brdr_b"),PU_CACHE);
 
-    for (x=0 ; x<scaledviewwidth ; x+=8)
-	V_DrawPatch(viewwindowx+x, viewwindowy+viewheight, patch);
+    for (x=0 ; x<width ; x+=8)
+	V_DrawPatch(left+x, top+height, patch);
     patch = W_CacheLumpName(DEH_String("brdr_l"),PU_CACHE);
 
-    for (y=0 ; y<viewheight ; y+=8)
-	V_DrawPatch(viewwindowx-8, viewwindowy+y, patch);
+    for (y=0 ; y<height ; y+=8)
+	V_DrawPatch(left-8, top+y, patch);
     patch = W_CacheLumpName(DEH_String("brdr_r"),PU_CACHE);
 
-    for (y=0 ; y<viewheight ; y+=8)
-	V_DrawPatch(viewwindowx+scaledviewwidth, viewwindowy+y, patch);
+    for (y=0 ; y<height ; y+=8)
+	V_DrawPatch(left+width, top+y, patch);
 
     // Draw beveled edge. 
-    V_DrawPatch(viewwindowx-8,
-                viewwindowy-8,
+    V_DrawPatch(left-8,
+                top-8,
                 W_CacheLumpName(DEH_String("brdr_tl"),PU_CACHE));
     
-    V_DrawPatch(viewwindowx+scaledviewwidth,
-                viewwindowy-8,
+    V_DrawPatch(left+width,
+                top-8,
                 W_CacheLumpName(DEH_String("brdr_tr"),PU_CACHE));
     
-    V_DrawPatch(viewwindowx-8,
-                viewwindowy+viewheight,
+    V_DrawPatch(left-8,
+                top+height,
                 W_CacheLumpName(DEH_String("brdr_bl"),PU_CACHE));
     
-    V_DrawPatch(viewwindowx+scaledviewwidth,
-                viewwindowy+viewheight,
+    V_DrawPatch(left+width,
+                top+height,
                 W_CacheLumpName(DEH_String("brdr_br"),PU_CACHE));
 
     V_RestoreBuffer();
@@ -23,15 +23,27 @@
 
 
 
-extern lighttable_t*	dc_colormap;
-extern int		dc_x;
-extern int		dc_yl;
-extern int		dc_yh;
-extern fixed_t		dc_iscale;
-extern fixed_t		dc_texturemid;
+// SOKOL CHANGE: every render thread has its own drawing state.
+extern THREADLOCAL lighttable_t*	dc_colormap;
+extern THREADLOCAL int		dc_x;
+extern THREADLOCAL int		dc_yl;
+extern THREADLOCAL int		dc_yh;
+extern THREADLOCAL fixed_t		dc_iscale;
+extern THREADLOCAL fixed_t		dc_texturemid;
 
 // first pixel in a column
-extern byte*		dc_source;		
+extern THREADLOCAL byte*		dc_source;		
+
+// SOKOL CHANGE: start of each row and column of the view,
+//  for drawers outside r_draw.c.
+extern byte**		ylookup;
+extern int*		columnofs;
+
+// SOKOL CHANGE: step to the next pixel down a column and along a
+//  span, which -colmajor swaps.
+extern int		dc_pitch;
+extern int		ds_pitch;
+extern boolean		colmajor;
 
 
 // The span blitting interface.
@@ -41,6 +53,10 @@ void 	R_DrawColumn (void);
 void 	R_DrawColumnLow (void);
 
 // The Spectre/Invisibility effect.
+#define FUZZTABLE		50 
+
+extern THREADLOCAL int	fuzzpos;
+
 void 	R_DrawFuzzColumn (void);
 void 	R_DrawFuzzColumnLow (void);
 
@@ -55,22 +71,28 @@ R_VideoErase
 ( unsigned	ofs,
   int		count );
 
-extern int		ds_y;
-extern int		ds_x1;
-extern int		ds_x2;
+extern THREADLOCAL int		ds_y;
+extern THREADLOCAL int		ds_x1;
+extern THREADLOCAL int		ds_x2;
 
-extern lighttable_t*	ds_colormap;
+extern THREADLOCAL lighttable_t*	ds_colormap;
 
-extern fixed_t		ds_xfrac;
-extern fixed_t		ds_yfrac;
-extern fixed_t		ds_xstep;
-extern fixed_t		ds_ystep;
+extern THREADLOCAL fixed_t		ds_xfrac;
+extern THREADLOCAL fixed_t		ds_yfrac;
+extern THREADLOCAL fixed_t		ds_xstep;
+extern THREADLOCAL fixed_t		ds_ystep;
 
 // start of a 64*64 tile image
-extern byte*		ds_source;		
+extern THREADLOCAL byte*		ds_source;		
+
+// SOKOL CHANGE: the span of each row of a flat drawn column by
+//  column, see R_DrawPlaneColumn.
+extern unsigned int*	ds_rowposition;
+extern unsigned int*	ds_rowstep;
+extern int*		ds_rowlight;
 
 extern byte*		translationtables;
-extern byte*		dc_translation;
+extern THREADLOCAL byte*		dc_translation;
 
 
 // Span blitting for rows, floor/ceiling.
@@ -80,12 +102,22 @@ void 	R_DrawSpan (void);
 // Low resolution mode, 160x200?
 void 	R_DrawSpanLow (void);
 
+// SOKOL CHANGE: a column of a flat, with -colmajor.
+void	R_DrawPlaneColumn (void);
+void	R_DrawPlaneColumnLow (void);
+
 
 void
 R_InitBuffer
 ( int		width,
   int		height );
 
+// Allocates the lookup tables and reads -colmajor.
+void	R_InitViewBuffer (void);
+
+// Copies the view to the screen when drawn column-major.
+void	R_TransposeView (void);
+
 
 // Initialize color translation tables,
 //  for player rendering etc.
@@ -93,6 +125,9 @@ void	R_InitTranslationTables (void);
 
 
 
+// The flat around a reduced view.
+byte* R_BorderFlat (void);
+
 // Rendering function.
 void R_FillBackScreen (void);
 
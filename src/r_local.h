@@ -41,5 +41,8 @@
 #include "r_data.h"
 #include "r_things.h"
 #include "r_draw.h"
+#include "r_strip.h"
+#include "r_simd.h"
+#include "r_prelit.h"
 
 #endif		// __R_LOCAL__
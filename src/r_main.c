@@ -31,6 +31,8 @@
 
 #include "m_bbox.h"
 #include "m_menu.h"
+#include "m_profile.h"
+#include "z_zone.h"
 
 #include "r_local.h"
 #include "r_sky.h"
@@ -60,6 +62,10 @@ fixed_t			centerxfrac;
 fixed_t			centeryfrac;
 fixed_t			projection;
 
+// SOKOL CHANGE: display frames between tics are drawn this far
+//  from the last tic to the next, FRACUNIT draws the last tic
+fixed_t			fractionaltic = FRACUNIT;
+
 // just for profiling purposes
 int			framecount;	
 
@@ -67,6 +73,8 @@ int			sscount;
 int			linecount;
 int			loopcount;
 
+highwater_t		highwater;
+
 fixed_t			viewx;
 fixed_t			viewy;
 fixed_t			viewz;
@@ -95,10 +103,12 @@ int			viewangletox[FINEANGLES/2];
 // The xtoviewangleangle[] table maps a screen pixel
 // to the lowest viewangle that maps back to x ranges
 // from clipangle to -clipangle.
-angle_t			xtoviewangle[SCREENWIDTH+1];
+// SOKOL CHANGE: allocated for the render resolution
+angle_t*		xtoviewangle;
 
-lighttable_t*		scalelight[LIGHTLEVELS][MAXLIGHTSCALE];
-lighttable_t*		scalelightfixed[MAXLIGHTSCALE];
+lighttable_t*		scalelight[LIGHTLEVELS][MAXLIGHTSCALE*MAXSCREENSCALE];
+lighttable_t*		scalelightfixed[MAXLIGHTSCALE*MAXSCREENSCALE];
+int			maxlightscale = MAXLIGHTSCALE;
 lighttable_t*		zlight[LIGHTLEVELS][MAXLIGHTZ];
 
 // bumped light from gun blasts
@@ -112,6 +122,13 @@ void (*fuzzcolfunc) (void);
 void (*transcolfunc) (void);
 void (*spanfunc) (void);
 
+// SOKOL CHANGE: walls and flats from the prelit cache
+void (*prelitcolfunc) (void);
+void (*prelitspanfunc) (void);
+
+// SOKOL CHANGE: flats with -colmajor, see R_DrawPlanes
+void (*planecolfunc) (void);
+
 
 
 //
@@ -147,34 +164,53 @@ R_PointOnSide
 ( fixed_t	x,
   fixed_t	y,
   node_t*	node )
+{
+    return R_PointOnPartitionSide (x, y, node->x, node->y,
+				   node->dx, node->dy);
+}
+
+
+//
+// R_PointOnPartitionSide
+// SOKOL CHANGE: R_PointOnSide with the partition line
+//  given apart, as in the depth first node arrays.
+//
+int
+R_PointOnPartitionSide
+( fixed_t	x,
+  fixed_t	y,
+  fixed_t	nodex,
+  fixed_t	nodey,
+  fixed_t	nodedx,
+  fixed_t	nodedy )
 {
     fixed_t	dx;
     fixed_t	dy;
     fixed_t	left;
     fixed_t	right;
 	
-    if (!node->dx)
+    if (!nodedx)
     {
-	if (x <= node->x)
-	    return node->dy > 0;
+	if (x <= nodex)
+	    return nodedy > 0;
 	
-	return node->dy < 0;
+	return nodedy < 0;
     }
-    if (!node->dy)
+    if (!nodedy)
     {
-	if (y <= node->y)
-	    return node->dx < 0;
+	if (y <= nodey)
+	    return nodedx < 0;
 	
-	return node->dx > 0;
+	return nodedx > 0;
     }
 	
-    dx = (x - node->x);
-    dy = (y - node->y);
+    dx = (x - nodex);
+    dy = (y - nodey);
 	
     // Try to quickly decide by looking at sign bits.
-    if ( (node->dy ^ node->dx ^ dx ^ dy)&0x80000000 )
+    if ( (nodedy ^ nodedx ^ dx ^ dy)&0x80000000 )
     {
-	if  ( (node->dy ^ dx) & 0x80000000 )
+	if  ( (nodedy ^ dx) & 0x80000000 )
 	{
 	    // (left is negative)
 	    return 1;
@@ -182,8 +218,8 @@ R_PointOnSide
 	return 0;
     }
 
-    left = FixedMul ( node->dy>>FRACBITS , dx );
-    right = FixedMul ( dy , node->dx>>FRACBITS );
+    left = FixedMul ( nodedy>>FRACBITS , dx );
+    right = FixedMul ( dy , nodedx>>FRACBITS );
 	
     if (right < left)
     {
@@ -550,7 +586,9 @@ void R_InitTextureMapping (void)
     //
     // Calc focallength
     //  so FIELDOFVIEW angles covers SCREENWIDTH.
-    focallength = FixedDiv (centerxfrac,
+    // SOKOL CHANGE: ...of a 320 unit wide screen, wider screens
+    //  see more to the sides.
+    focallength = FixedDiv (projection,
 			    finetangent[FINEANGLES/4+FIELDOFVIEW/2] );
 	
     for (i=0 ; i<FINEANGLES/2 ; i++)
@@ -622,7 +660,8 @@ void R_InitLightTables (void)
 	startmap = ((LIGHTLEVELS-1-i)*2)*NUMCOLORMAPS/LIGHTLEVELS;
 	for (j=0 ; j<MAXLIGHTZ ; j++)
 	{
-	    scale = FixedDiv ((SCREENWIDTH/2*FRACUNIT), (j+1)<<LIGHTZSHIFT);
+	    // SOKOL CHANGE: distances do not change with the resolution
+	    scale = FixedDiv ((ORIGWIDTH/2*FRACUNIT), (j+1)<<LIGHTZSHIFT);
 	    scale >>= LIGHTSCALESHIFT;
 	    level = startmap - scale/DISTMAP;
 	    
@@ -672,6 +711,7 @@ void R_ExecuteSetViewSize (void)
     int		j;
     int		level;
     int		startmap; 	
+    int		nonwidewidth;
 
     setsizeneeded = false;
 
@@ -682,25 +722,38 @@ void R_ExecuteSetViewSize (void)
     }
     else
     {
-	scaledviewwidth = setblocks*32;
-	viewheight = (setblocks*168/10)&~7;
+	// SOKOL CHANGE: a share of the (maybe wide) screen
+	scaledviewwidth = setblocks*(SCREENWIDTH/screenscale)/10;
+	if (setblocks < 10)
+	    scaledviewwidth &= ~7;
+	scaledviewwidth *= screenscale;
+	viewheight = ((setblocks*168/10)&~7)*screenscale;
     }
     
     detailshift = setdetail;
     viewwidth = scaledviewwidth>>detailshift;
+
+    // SOKOL CHANGE: the width the view would have on a 320 unit
+    //  wide screen. It sets the projection, so a wide screen keeps
+    //  the vertical field of view and widens the horizontal one.
+    nonwidewidth = viewwidth*ORIGWIDTH/(SCREENWIDTH/screenscale);
 	
     centery = viewheight/2;
     centerx = viewwidth/2;
     centerxfrac = centerx<<FRACBITS;
     centeryfrac = centery<<FRACBITS;
-    projection = centerxfrac;
+    projection = (nonwidewidth/2)<<FRACBITS;
 
     if (!detailshift)
     {
-	colfunc = basecolfunc = R_DrawColumn;
+	// SOKOL CHANGE: the drawers picked for the CPU
+	colfunc = basecolfunc = simdcolfunc;
 	fuzzcolfunc = R_DrawFuzzColumn;
 	transcolfunc = R_DrawTranslatedColumn;
-	spanfunc = R_DrawSpan;
+	spanfunc = simdspanfunc;
+	prelitcolfunc = simdprelitcolfunc;
+	prelitspanfunc = simdprelitspanfunc;
+	planecolfunc = simdplanecolfunc;
     }
     else
     {
@@ -708,6 +761,9 @@ void R_ExecuteSetViewSize (void)
 	fuzzcolfunc = R_DrawFuzzColumnLow;
 	transcolfunc = R_DrawTranslatedColumnLow;
 	spanfunc = R_DrawSpanLow;
+	prelitcolfunc = R_DrawPrelitColumnLow;
+	prelitspanfunc = R_DrawPrelitSpanLow;
+	planecolfunc = R_DrawPlaneColumnLow;
     }
 
     R_InitBuffer (scaledviewwidth, viewheight);
@@ -715,8 +771,8 @@ void R_ExecuteSetViewSize (void)
     R_InitTextureMapping ();
     
     // psprite scales
-    pspritescale = FRACUNIT*viewwidth/SCREENWIDTH;
-    pspriteiscale = FRACUNIT*SCREENWIDTH/viewwidth;
+    pspritescale = FRACUNIT*nonwidewidth/ORIGWIDTH;
+    pspriteiscale = FRACUNIT*ORIGWIDTH/nonwidewidth;
     
     // thing clipping
     for (i=0 ; i<viewwidth ; i++)
@@ -727,7 +783,7 @@ void R_ExecuteSetViewSize (void)
     {
 	dy = ((i-viewheight/2)<<FRACBITS)+FRACUNIT/2;
 	dy = abs(dy);
-	yslope[i] = FixedDiv ( (viewwidth<<detailshift)/2*FRACUNIT, dy);
+	yslope[i] = FixedDiv ( (nonwidewidth<<detailshift)/2*FRACUNIT, dy);
     }
 	
     for (i=0 ; i<viewwidth ; i++)
@@ -738,12 +794,16 @@ void R_ExecuteSetViewSize (void)
     
     // Calculate the light levels to use
     //  for each level / scale combination.
+    // SOKOL CHANGE: scales grow with the resolution, so the table
+    //  does too, to light walls and sprites at the same distances.
+    maxlightscale = MAXLIGHTSCALE*screenscale;
+
     for (i=0 ; i< LIGHTLEVELS ; i++)
     {
 	startmap = ((LIGHTLEVELS-1-i)*2)*NUMCOLORMAPS/LIGHTLEVELS;
-	for (j=0 ; j<MAXLIGHTSCALE ; j++)
+	for (j=0 ; j<maxlightscale ; j++)
 	{
-	    level = startmap - j*SCREENWIDTH/(viewwidth<<detailshift)/DISTMAP;
+	    level = startmap - j*ORIGWIDTH/(nonwidewidth<<detailshift)/DISTMAP;
 	    
 	    if (level < 0)
 		level = 0;
@@ -754,6 +814,9 @@ void R_ExecuteSetViewSize (void)
 	    scalelight[i][j] = colormaps + level*256;
 	}
     }
+
+    // SOKOL CHANGE: queue for the render threads
+    R_SetupStrips ();
 }
 
 
@@ -775,13 +838,19 @@ void R_Init (void)
     printf (".");
 
     R_SetViewSize (screenblocks, detailLevel);
+    xtoviewangle = Z_Malloc ((SCREENWIDTH+1) * sizeof(*xtoviewangle),
+			     PU_STATIC, NULL);
     R_InitPlanes ();
     printf (".");
     R_InitLightTables ();
     printf (".");
     R_InitSkyMap ();
     R_InitTranslationTables ();
+    R_InitViewBuffer ();
+    R_InitSIMD ();
+    R_InitPrelit ();
     printf (".");
+    R_InitStrips ();
 	
     framecount = 0;
 }
@@ -824,13 +893,32 @@ void R_SetupFrame (player_t* player)
 {		
     int		i;
     
+    mobj_t*	mo;
+    
     viewplayer = player;
-    viewx = player->mo->x;
-    viewy = player->mo->y;
-    viewangle = player->mo->angle + viewangleoffset;
-    extralight = player->extralight;
+    mo = player->mo;
+
+    // SOKOL CHANGE: on display frames between tics, seen from
+    //  in between
+    if (fractionaltic != FRACUNIT && mo->oldgametic == gametic-1)
+    {
+	viewx = mo->oldx + FixedMul (mo->x - mo->oldx, fractionaltic);
+	viewy = mo->oldy + FixedMul (mo->y - mo->oldy, fractionaltic);
+	viewangle = mo->oldangle
+	    + FixedMul (mo->angle - mo->oldangle, fractionaltic)
+	    + viewangleoffset;
+	viewz = player->oldviewz
+	    + FixedMul (player->viewz - player->oldviewz, fractionaltic);
+    }
+    else
+    {
+	viewx = mo->x;
+	viewy = mo->y;
+	viewangle = mo->angle + viewangleoffset;
+	viewz = player->viewz;
+    }
 
-    viewz = player->viewz;
+    extralight = player->extralight;
     
     viewsin = finesine[viewangle>>ANGLETOFINESHIFT];
     viewcos = finecosine[viewangle>>ANGLETOFINESHIFT];
@@ -845,7 +933,7 @@ void R_SetupFrame (player_t* player)
 	
 	walllights = scalelightfixed;
 
-	for (i=0 ; i<MAXLIGHTSCALE ; i++)
+	for (i=0 ; i<maxlightscale ; i++)
 	    scalelightfixed[i] = fixedcolormap;
     }
     else
@@ -857,13 +945,86 @@ void R_SetupFrame (player_t* player)
 
 
 
+//
+// UpdateHighWater
+// SOKOL CHANGE: solidsegs are counted as they are inserted.
+//
+static void UpdateHighWater (void)
+{
+    if (numvisplanes > highwater.visplanes)
+	highwater.visplanes = numvisplanes;
+
+    if (ds_p - drawsegs > highwater.drawsegs)
+	highwater.drawsegs = ds_p - drawsegs;
+
+    if (vissprite_p - vissprites > highwater.vissprites)
+	highwater.vissprites = vissprite_p - vissprites;
+
+    if (lastopening - openings > highwater.openings)
+	highwater.openings = lastopening - openings;
+}
+
+
+
+//
+// R_InterpolateSectors
+// SOKOL CHANGE: on display frames between tics, sectors that moved
+//  in the last tic are drawn in between. R_RestoreSectors puts
+//  the heights of the tic back for the playsim.
+//
+static void R_InterpolateSectors (void)
+{
+    sector_t*	sector;
+    int		i;
+
+    for (i=0, sector=sectors ; i<numsectors ; i++, sector++)
+    {
+	if (sector->oldgametic != gametic-1)
+	    continue;
+
+	sector->ticfloorheight = sector->floorheight;
+	sector->ticceilingheight = sector->ceilingheight;
+
+	sector->floorheight = sector->oldfloorheight
+	    + FixedMul (sector->floorheight - sector->oldfloorheight,
+			fractionaltic);
+	sector->ceilingheight = sector->oldceilingheight
+	    + FixedMul (sector->ceilingheight - sector->oldceilingheight,
+			fractionaltic);
+    }
+}
+
+static void R_RestoreSectors (void)
+{
+    sector_t*	sector;
+    int		i;
+
+    for (i=0, sector=sectors ; i<numsectors ; i++, sector++)
+    {
+	if (sector->oldgametic != gametic-1)
+	    continue;
+
+	sector->floorheight = sector->ticfloorheight;
+	sector->ceilingheight = sector->ticceilingheight;
+    }
+}
+
+
+
 //
 // R_RenderView
 //
 void R_RenderPlayerView (player_t* player)
 {	
+    boolean	interpolate;
+
     R_SetupFrame (player);
 
+    interpolate = fractionaltic != FRACUNIT;
+
+    if (interpolate)
+	R_InterpolateSectors ();
+
     // Clear buffers.
     R_ClearClipSegs ();
     R_ClearDrawSegs ();
@@ -875,19 +1036,50 @@ void R_RenderPlayerView (player_t* player)
     // NetUpdate ();
 
     // The head node is the last node output.
-    R_RenderBSPNode (numnodes-1);
+    // SOKOL CHANGE: and laid out first
+    PROFILE_BEGIN ("R_RenderBSPNode");
+    R_RenderBSPNode (bsproot);
+    PROFILE_END ();
+
+    // SOKOL CHANGE: the walls can be sorted
+    R_EndSortedBatch ();
     
     // Check for new console commands.
     // SOKOL CHANGE
     //NetUpdate ();
     
+    PROFILE_BEGIN ("R_DrawPlanes");
     R_DrawPlanes ();
+    PROFILE_END ();
+
+    // SOKOL CHANGE: the planes can be sorted, not the sprites
+    R_EndSortedBatch ();
     
     // Check for new console commands.
     // SOKOL CHANGE
     //NetUpdate ();
     
+    PROFILE_BEGIN ("R_DrawMasked");
     R_DrawMasked ();
+    PROFILE_END ();
+
+    // SOKOL CHANGE: with render threads nothing is drawn until here
+    PROFILE_BEGIN ("R_DrawStrips");
+    R_DrawStrips ();
+    PROFILE_END ();
+
+    // SOKOL CHANGE: to the screen if drawn to the view buffer
+    if (colmajor)
+    {
+	PROFILE_BEGIN ("R_TransposeView");
+	R_TransposeView ();
+	PROFILE_END ();
+    }
+
+    UpdateHighWater ();
+
+    if (interpolate)
+	R_RestoreSectors ();
 
     // Check for new console commands.
     // SOKOL CHANGE
@@ -43,13 +43,31 @@ extern int		centery;
 extern fixed_t		centerxfrac;
 extern fixed_t		centeryfrac;
 extern fixed_t		projection;
+extern fixed_t		fractionaltic;
 
 extern int		validcount;
 
+// SOKOL CHANGE: counts the frames drawn
+extern int		framecount;
+
 extern int		linecount;
 extern int		loopcount;
 
 
+// SOKOL CHANGE: the most entries the renderer arrays held in a frame,
+//  they grow as needed instead of dropping what does not fit.
+typedef struct
+{
+    int		visplanes;
+    int		drawsegs;
+    int		vissprites;
+    int		openings;
+    int		solidsegs;
+} highwater_t;
+
+extern highwater_t	highwater;
+
+
 //
 // Lighting LUT.
 // Used for z-depth cuing per column/row,
@@ -61,13 +79,16 @@ extern int		loopcount;
 #define LIGHTLEVELS	        16
 #define LIGHTSEGSHIFT	         4
 
+// SOKOL CHANGE: the scale tables hold maxlightscale entries,
+//  MAXLIGHTSCALE times screenscale, as wall scales grow with it.
 #define MAXLIGHTSCALE		48
 #define LIGHTSCALESHIFT		12
 #define MAXLIGHTZ	       128
 #define LIGHTZSHIFT		20
 
-extern lighttable_t*	scalelight[LIGHTLEVELS][MAXLIGHTSCALE];
-extern lighttable_t*	scalelightfixed[MAXLIGHTSCALE];
+extern lighttable_t*	scalelight[LIGHTLEVELS][MAXLIGHTSCALE*MAXSCREENSCALE];
+extern lighttable_t*	scalelightfixed[MAXLIGHTSCALE*MAXSCREENSCALE];
+extern int		maxlightscale;
 extern lighttable_t*	zlight[LIGHTLEVELS][MAXLIGHTZ];
 
 extern int		extralight;
@@ -96,6 +117,13 @@ extern void		(*fuzzcolfunc) (void);
 // No shadow effects on floors.
 extern void		(*spanfunc) (void);
 
+// SOKOL CHANGE: the drawers for prelit sources, see r_prelit.c.
+extern void		(*prelitcolfunc) (void);
+extern void		(*prelitspanfunc) (void);
+
+// SOKOL CHANGE: flats drawn column by column with -colmajor.
+extern void		(*planecolfunc) (void);
+
 
 //
 // Utility functions.
@@ -105,6 +133,16 @@ R_PointOnSide
   fixed_t	y,
   node_t*	node );
 
+// SOKOL CHANGE
+int
+R_PointOnPartitionSide
+( fixed_t	x,
+  fixed_t	y,
+  fixed_t	nodex,
+  fixed_t	nodey,
+  fixed_t	nodedx,
+  fixed_t	nodedy );
+
 int
 R_PointOnSegSide
 ( fixed_t	x,
@@ -21,6 +21,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "i_system.h"
 #include "z_zone.h"
@@ -42,16 +43,27 @@ planefunction_t		ceilingfunc;
 //
 
 // Here comes the obnoxious "visplane".
-#define MAXVISPLANES	128
-visplane_t		visplanes[MAXVISPLANES];
-visplane_t*		lastvisplane;
+// SOKOL CHANGE: instead of a fixed array of MAXVISPLANES, visplanes
+//  are allocated in blocks as needed and kept from frame to frame.
+//  visplanes[] is in the order they were made this frame, which is
+//  the order they are drawn in. R_FindPlane looks them up by a hash
+//  on height, picnum and lightlevel.
+#define VISPLANEBLOCK	128
+#define VISPLANEHASH	128
+
+visplane_t**		visplanes;
+int			numvisplanes;
+static int		maxvisplanes;
+static visplane_t*	visplanehash[VISPLANEHASH];
 visplane_t*		floorplane;
 visplane_t*		ceilingplane;
 
 // ?
+// SOKOL CHANGE: initial size, openings[] grows as needed
 #define MAXOPENINGS	SCREENWIDTH*64
-short			openings[MAXOPENINGS];
+short*			openings;
 short*			lastopening;
+static int		maxopenings;
 
 
 //
@@ -59,15 +71,17 @@ short*			lastopening;
 //  floorclip starts out SCREENHEIGHT
 //  ceilingclip starts out -1
 //
-short			floorclip[SCREENWIDTH];
-short			ceilingclip[SCREENWIDTH];
+// SOKOL CHANGE: all of these are allocated for the render
+//  resolution in R_InitPlanes.
+short*			floorclip;
+short*			ceilingclip;
 
 //
 // spanstart holds the start of a plane span
 // initialized to 0 at start
 //
-int			spanstart[SCREENHEIGHT];
-int			spanstop[SCREENHEIGHT];
+int*			spanstart;
+int*			spanstop;
 
 //
 // texture mapping
@@ -75,15 +89,19 @@ int			spanstop[SCREENHEIGHT];
 lighttable_t**		planezlight;
 fixed_t			planeheight;
 
-fixed_t			yslope[SCREENHEIGHT];
-fixed_t			distscale[SCREENWIDTH];
+// SOKOL CHANGE: the flat of the plane, for the prelit cache
+static int		planelump;
+static byte*		planesource;
+
+fixed_t*		yslope;
+fixed_t*		distscale;
 fixed_t			basexscale;
 fixed_t			baseyscale;
 
-fixed_t			cachedheight[SCREENHEIGHT];
-fixed_t			cacheddistance[SCREENHEIGHT];
-fixed_t			cachedxstep[SCREENHEIGHT];
-fixed_t			cachedystep[SCREENHEIGHT];
+fixed_t*		cachedheight;
+fixed_t*		cacheddistance;
+fixed_t*		cachedxstep;
+fixed_t*		cachedystep;
 
 
 
@@ -93,43 +111,33 @@ fixed_t			cachedystep[SCREENHEIGHT];
 //
 void R_InitPlanes (void)
 {
-  // Doh!
+    // SOKOL CHANGE: the render resolution is set by now
+    floorclip = Z_Malloc (SCREENWIDTH * sizeof(*floorclip), PU_STATIC, NULL);
+    ceilingclip = Z_Malloc (SCREENWIDTH * sizeof(*ceilingclip), PU_STATIC, NULL);
+    distscale = Z_Malloc (SCREENWIDTH * sizeof(*distscale), PU_STATIC, NULL);
+
+    spanstart = Z_Malloc (SCREENHEIGHT * sizeof(*spanstart), PU_STATIC, NULL);
+    spanstop = Z_Malloc (SCREENHEIGHT * sizeof(*spanstop), PU_STATIC, NULL);
+    yslope = Z_Malloc (SCREENHEIGHT * sizeof(*yslope), PU_STATIC, NULL);
+    cachedheight = Z_Malloc (SCREENHEIGHT * sizeof(*cachedheight), PU_STATIC, NULL);
+    cacheddistance = Z_Malloc (SCREENHEIGHT * sizeof(*cacheddistance), PU_STATIC, NULL);
+    cachedxstep = Z_Malloc (SCREENHEIGHT * sizeof(*cachedxstep), PU_STATIC, NULL);
+    cachedystep = Z_Malloc (SCREENHEIGHT * sizeof(*cachedystep), PU_STATIC, NULL);
 }
 
 
 //
-// R_MapPlane
-//
-// Uses global vars:
-//  planeheight
-//  ds_source
-//  basexscale
-//  baseyscale
-//  viewx
-//  viewy
-//
-// BASIC PRIMITIVE
+// R_SetupSpan
+// SOKOL CHANGE: the texture position, steps and colormap of a span
+//  starting at x1 on row y, set up in ds_* for R_MapPlane and for the
+//  column by column flats.
 //
-void
-R_MapPlane
-( int		y,
-  int		x1,
-  int		x2 )
+static void R_SetupSpan (int y, int x1)
 {
     angle_t	angle;
     fixed_t	distance;
     fixed_t	length;
     unsigned	index;
-	
-#ifdef RANGECHECK
-    if (x2 < x1
-     || x1 < 0
-     || x2 >= viewwidth
-     || y > viewheight)
-    {
-	I_Error ("R_MapPlane: %i, %i at %i",x1,x2,y);
-    }
-#endif
 
     if (planeheight != cachedheight[y])
     {
@@ -161,11 +169,75 @@ R_MapPlane
 
 	ds_colormap = planezlight[index];
     }
+}
+
+
+//
+// R_StartPlaneRow
+// SOKOL CHANGE: starts the span of row y at x for planecolfunc,
+//  set up as R_MapPlane sets up a span.
+//
+static void R_StartPlaneRow (int y, int x)
+{
+    R_SetupSpan (y, x);
+
+    ds_rowposition[y] = ((ds_xfrac << 10) & 0xffff0000)
+		      | ((ds_yfrac >> 6)  & 0x0000ffff);
+    ds_rowstep[y] = ((ds_xstep << 10) & 0xffff0000)
+		  | ((ds_ystep >> 6)  & 0x0000ffff);
+    ds_rowlight[y] = ds_colormap - colormaps;
+}
+
+
+//
+// R_MapPlane
+//
+// Uses global vars:
+//  planeheight
+//  planesource
+//  basexscale
+//  baseyscale
+//  viewx
+//  viewy
+//
+// BASIC PRIMITIVE
+//
+void
+R_MapPlane
+( int		y,
+  int		x1,
+  int		x2 )
+{
+    byte*	prelit;
 	
+#ifdef RANGECHECK
+    if (x2 < x1
+     || x1 < 0
+     || x2 >= viewwidth
+     || y > viewheight)
+    {
+	I_Error ("R_MapPlane: %i, %i at %i",x1,x2,y);
+    }
+#endif
+
+    R_SetupSpan (y, x1);
+
     ds_y = y;
     ds_x1 = x1;
     ds_x2 = x2;
 
+    // SOKOL CHANGE: from the prelit cache when it has the flat
+    prelit = R_PrelitFlat (planelump, planesource, ds_colormap);
+
+    if (prelit)
+    {
+	ds_source = prelit;
+	prelitspanfunc ();
+	return;
+    }
+
+    ds_source = planesource;
+
     // high or low detail
     spanfunc ();	
 }
@@ -187,23 +259,143 @@ void R_ClearPlanes (void)
 	ceilingclip[i] = -1;
     }
 
-    lastvisplane = visplanes;
+    numvisplanes = 0;
+    memset (visplanehash, 0, sizeof(visplanehash));
+
+    if (openings == NULL)
+	R_CheckOpenings (MAXOPENINGS);
+
     lastopening = openings;
     
     // texture calculation
-    memset (cachedheight, 0, sizeof(cachedheight));
+    memset (cachedheight, 0, SCREENHEIGHT*sizeof(*cachedheight));
 
     // left to right mapping
     angle = (viewangle-ANG90)>>ANGLETOFINESHIFT;
 	
     // scale will be unit scale at SCREENWIDTH/2 distance
-    basexscale = FixedDiv (finecosine[angle],centerxfrac);
-    baseyscale = -FixedDiv (finesine[angle],centerxfrac);
+    // SOKOL CHANGE: projection, not centerxfrac, on a wide screen
+    basexscale = FixedDiv (finecosine[angle],projection);
+    baseyscale = -FixedDiv (finesine[angle],projection);
 }
 
 
 
 
+//
+// MoveOpenings
+// Points a drawseg's openings into the new openings[].
+//
+static void
+MoveOpenings
+( short**	p,
+  int		x1,
+  short*	newopenings )
+{
+    // The pointers are offset by the first column of the drawseg,
+    //  they may also point to screenheightarray or negonearray.
+    if (*p != NULL && *p + x1 >= openings && *p + x1 < lastopening)
+	*p = newopenings + (*p - openings);
+}
+
+
+//
+// R_CheckOpenings
+// Makes room for count more openings, moving the ones in use
+//  along with the drawsegs that point into them.
+//
+void R_CheckOpenings (int count)
+{
+    short*	newopenings;
+    drawseg_t*	ds;
+    int		used;
+
+    used = lastopening - openings;
+
+    if (used + count <= maxopenings)
+	return;
+
+    if (maxopenings == 0)
+	maxopenings = MAXOPENINGS;
+
+    while (used + count > maxopenings)
+	maxopenings *= 2;
+
+    newopenings = Z_Malloc (maxopenings * sizeof(*newopenings),
+			    PU_STATIC, NULL);
+
+    if (openings != NULL)
+    {
+	memcpy (newopenings, openings, used * sizeof(*openings));
+
+	for (ds = drawsegs ; ds < ds_p ; ds++)
+	{
+	    MoveOpenings (&ds->maskedtexturecol, ds->x1, newopenings);
+	    MoveOpenings (&ds->sprtopclip, ds->x1, newopenings);
+	    MoveOpenings (&ds->sprbottomclip, ds->x1, newopenings);
+	}
+
+	Z_Free (openings);
+    }
+
+    openings = newopenings;
+    lastopening = openings + used;
+}
+
+
+//
+// NewVisplane
+// The next free visplane, allocates another block when all are in use.
+//
+static visplane_t *NewVisplane (void)
+{
+    visplane_t**	newvisplanes;
+    visplane_t*		block;
+    unsigned short*	columns;
+    int			size;
+    int			i;
+
+    if (numvisplanes == maxvisplanes)
+    {
+	newvisplanes = Z_Malloc ((maxvisplanes + VISPLANEBLOCK)
+				 * sizeof(*newvisplanes), PU_STATIC, NULL);
+
+	// top[] and bottom[] follow the planes, with a pad on each side
+	size = VISPLANEBLOCK * (sizeof(*block)
+				+ 2 * (SCREENWIDTH+2) * sizeof(*columns));
+	block = Z_Malloc (size, PU_STATIC, NULL);
+	columns = (unsigned short *) (block + VISPLANEBLOCK);
+
+	// R_MakeSpans reads bottom[] of columns that were never drawn,
+	//  which must not be 0xffff, as in the static array this replaces.
+	memset (block, 0, size);
+
+	for (i=0 ; i<VISPLANEBLOCK ; i++)
+	{
+	    block[i].top = columns + 1;
+	    columns += SCREENWIDTH+2;
+	    block[i].bottom = columns + 1;
+	    columns += SCREENWIDTH+2;
+	}
+
+	if (visplanes != NULL)
+	{
+	    memcpy (newvisplanes, visplanes,
+		    maxvisplanes * sizeof(*newvisplanes));
+	    Z_Free (visplanes);
+	}
+
+	for (i=0 ; i<VISPLANEBLOCK ; i++)
+	    newvisplanes[maxvisplanes + i] = &block[i];
+
+	visplanes = newvisplanes;
+	maxvisplanes += VISPLANEBLOCK;
+    }
+
+    return visplanes[numvisplanes++];
+}
+
+
 //
 // R_FindPlane
 //
@@ -214,31 +406,34 @@ R_FindPlane
   int		lightlevel )
 {
     visplane_t*	check;
+    unsigned	hash;
 	
     if (picnum == skyflatnum)
     {
 	height = 0;			// all skys map together
 	lightlevel = 0;
     }
+
+    // Only planes made here are in the hash, the ones split off by
+    //  R_CheckPlane come later in visplanes[] and were never found
+    //  by the linear search either.
+    hash = ((unsigned) (height >> FRACBITS) * 7
+	    + (unsigned) picnum * 3
+	    + (unsigned) lightlevel) & (VISPLANEHASH - 1);
 	
-    for (check=visplanes; check<lastvisplane; check++)
+    for (check=visplanehash[hash]; check; check=check->next)
     {
 	if (height == check->height
 	    && picnum == check->picnum
 	    && lightlevel == check->lightlevel)
 	{
-	    break;
+	    return check;
 	}
     }
-    
-			
-    if (check < lastvisplane)
-	return check;
-		
-    if (lastvisplane - visplanes == MAXVISPLANES)
-	I_Error ("R_FindPlane: no more visplanes");
-		
-    lastvisplane++;
+
+    check = NewVisplane ();
+    check->next = visplanehash[hash];
+    visplanehash[hash] = check;
 
     check->height = height;
     check->picnum = picnum;
@@ -246,7 +441,7 @@ R_FindPlane
     check->minx = SCREENWIDTH;
     check->maxx = -1;
     
-    memset (check->top,0xff,sizeof(check->top));
+    memset (check->top,0xff,SCREENWIDTH*sizeof(*check->top));
 		
     return check;
 }
@@ -266,6 +461,7 @@ R_CheckPlane
     int		unionl;
     int		unionh;
     int		x;
+    visplane_t*	check;
 	
     if (start < pl->minx)
     {
@@ -290,7 +486,7 @@ R_CheckPlane
     }
 
     for (x=intrl ; x<= intrh ; x++)
-	if (pl->top[x] != 0xff)
+	if (pl->top[x] != 0xffff)
 	    break;
 
     if (x > intrh)
@@ -303,15 +499,17 @@ R_CheckPlane
     }
 	
     // make a new visplane
-    lastvisplane->height = pl->height;
-    lastvisplane->picnum = pl->picnum;
-    lastvisplane->lightlevel = pl->lightlevel;
+    check = NewVisplane ();
+    check->next = NULL;
+    check->height = pl->height;
+    check->picnum = pl->picnum;
+    check->lightlevel = pl->lightlevel;
     
-    pl = lastvisplane++;
+    pl = check;
     pl->minx = start;
     pl->maxx = stop;
 
-    memset (pl->top,0xff,sizeof(pl->top));
+    memset (pl->top,0xff,SCREENWIDTH*sizeof(*pl->top));
 		
     return pl;
 }
@@ -353,6 +551,39 @@ R_MakeSpans
 
 
 
+//
+// R_StartPlaneRows
+// SOKOL CHANGE: R_MakeSpans for the flats drawn column by column.
+//  Rows whose span starts at x are set up, there is nothing to do
+//  where spans end. The prelit cache is not used, an entry could be
+//  replaced while its span is still being drawn.
+//
+static void
+R_StartPlaneRows
+( int		x,
+  int		t1,
+  int		b1,
+  int		t2,
+  int		b2 )
+{
+    while (t1 < t2 && t1<=b1)
+	t1++;
+    while (b1 > b2 && b1>=t1)
+	b1--;
+
+    while (t2 < t1 && t2<=b2)
+    {
+	R_StartPlaneRow (t2, x);
+	t2++;
+    }
+    while (b2 > b1 && b2>=t2)
+    {
+	R_StartPlaneRow (b2, x);
+	b2--;
+    }
+}
+
+
 //
 // R_DrawPlanes
 // At the end of each frame.
@@ -365,23 +596,22 @@ void R_DrawPlanes (void)
     int			stop;
     int			angle;
     int                 lumpnum;
+    int			i;
 				
 #ifdef RANGECHECK
-    if (ds_p - drawsegs > MAXDRAWSEGS)
+    if (ds_p - drawsegs > maxdrawsegs)
 	I_Error ("R_DrawPlanes: drawsegs overflow (%i)",
 		 ds_p - drawsegs);
     
-    if (lastvisplane - visplanes > MAXVISPLANES)
-	I_Error ("R_DrawPlanes: visplane overflow (%i)",
-		 lastvisplane - visplanes);
-    
-    if (lastopening - openings > MAXOPENINGS)
+    if (lastopening - openings > maxopenings)
 	I_Error ("R_DrawPlanes: opening overflow (%i)",
 		 lastopening - openings);
 #endif
 
-    for (pl = visplanes ; pl < lastvisplane ; pl++)
+    for (i = 0 ; i < numvisplanes ; i++)
     {
+	pl = visplanes[i];
+
 	if (pl->minx > pl->maxx)
 	    continue;
 
@@ -415,7 +645,8 @@ void R_DrawPlanes (void)
 	
 	// regular flat
         lumpnum = firstflat + flattranslation[pl->picnum];
-	ds_source = W_CacheLumpNum(lumpnum, PU_STATIC);
+	planelump = lumpnum;
+	planesource = W_CacheLumpNum(lumpnum, PU_STATIC);
 	
 	planeheight = abs(pl->height-viewz);
 	light = (pl->lightlevel >> LIGHTSEGSHIFT)+extralight;
@@ -428,17 +659,41 @@ void R_DrawPlanes (void)
 
 	planezlight = zlight[light];
 
-	pl->top[pl->maxx+1] = 0xff;
-	pl->top[pl->minx-1] = 0xff;
+	pl->top[pl->maxx+1] = 0xffff;
+	pl->top[pl->minx-1] = 0xffff;
 		
 	stop = pl->maxx + 1;
 
-	for (x=pl->minx ; x<= stop ; x++)
+	// SOKOL CHANGE: with -colmajor, unless queued, column by column
+	//  so that the flat is written to the view buffer in order.
+	if (colmajor && !stripdrawing)
+	{
+	    ds_source = planesource;
+
+	    for (x=pl->minx ; x< stop ; x++)
+	    {
+		R_StartPlaneRows(x,pl->top[x-1],
+				 pl->bottom[x-1],
+				 pl->top[x],
+				 pl->bottom[x]);
+
+		dc_x = x;
+		dc_yl = pl->top[x];
+		dc_yh = pl->bottom[x];
+
+		if (dc_yl <= dc_yh)
+		    planecolfunc ();
+	    }
+	}
+	else
 	{
-	    R_MakeSpans(x,pl->top[x-1],
-			pl->bottom[x-1],
-			pl->top[x],
-			pl->bottom[x]);
+	    for (x=pl->minx ; x<= stop ; x++)
+	    {
+		R_MakeSpans(x,pl->top[x-1],
+			    pl->bottom[x-1],
+			    pl->top[x],
+			    pl->bottom[x]);
+	    }
 	}
 	
         W_ReleaseLumpNum(lumpnum);
@@ -0,0 +1,506 @@
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Prelit texture cache: wall textures and flats with a colormap
+//	 already applied.
+//
+// Every wall and flat pixel is looked up twice, the texel and then its
+// colormap entry. With -prelit the cache keeps a copy of a texture for
+// each colormap it is drawn with, which the prelit drawers read the
+// final color from. A wall column is copied when first drawn, only the
+// 128 texels the drawers reach; textures whose short columns would
+// have them read past the end of the patch are not cached. Flats are
+// copied whole.
+//
+// Copies are dropped least recently drawn first to stay within the
+// budget, but never those drawn in this frame, as the strip queues may
+// still point into them. When there is no room the wall or flat is
+// drawn from the texture as before. The picture is the same.
+//
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "doomdef.h"
+
+#include "i_system.h"
+#include "m_argv.h"
+#include "w_wad.h"
+#include "z_zone.h"
+
+#include "r_local.h"
+#include "r_prelit.h"
+
+// texels of a wall column the drawers reach
+#define COLUMNTEXELS	128
+
+#define FLATTEXELS	(64*64)
+
+#define HASHSIZE	1024
+
+typedef struct prelit_s
+{
+    // texture number, or -1 - lump for a flat
+    int			source;
+
+    // colormap number
+    int			light;
+
+    int			lastframe;
+    size_t		size;
+
+    // columns copied yet, NULL for a flat
+    byte*		built;
+    byte*		data;
+
+    struct prelit_s*	hashnext;
+
+    // least recently drawn order
+    struct prelit_s*	prev;
+    struct prelit_s*	next;
+} prelit_t;
+
+prelitstats_t		prelitstats;
+
+static size_t		budget;
+static size_t		used;
+
+static prelit_t*	hashtable[HASHSIZE];
+
+// lru.next was drawn last, lru.prev is the first to drop
+static prelit_t		lru;
+
+// 1 if a texture can be cached, -1 if not, 0 not checked yet
+static signed char*	texturefits;
+
+
+//
+// Prelit drawers, R_DrawColumn and R_DrawSpan without the colormap.
+//
+void R_DrawPrelitColumn (void)
+{
+    int			count;
+    byte*		dest;
+    fixed_t		frac;
+    fixed_t		fracstep;
+
+    count = dc_yh - dc_yl;
+
+    if (count < 0)
+	return;
+
+#ifdef RANGECHECK
+    if ((unsigned)dc_x >= SCREENWIDTH
+	|| dc_yl < 0
+	|| dc_yh >= SCREENHEIGHT)
+	I_Error ("R_DrawPrelitColumn: %i to %i at %i", dc_yl, dc_yh, dc_x);
+#endif
+
+    dest = ylookup[dc_yl] + columnofs[dc_x];
+
+    fracstep = dc_iscale;
+    frac = dc_texturemid + (dc_yl-centery)*fracstep;
+
+    do
+    {
+	*dest = dc_source[(frac>>FRACBITS)&127];
+
+	dest += dc_pitch;
+	frac += fracstep;
+
+    } while (count--);
+}
+
+void R_DrawPrelitColumnLow (void)
+{
+    int			count;
+    byte*		dest;
+    byte*		dest2;
+    fixed_t		frac;
+    fixed_t		fracstep;
+    int			x;
+
+    count = dc_yh - dc_yl;
+
+    if (count < 0)
+	return;
+
+#ifdef RANGECHECK
+    if ((unsigned)dc_x >= SCREENWIDTH
+	|| dc_yl < 0
+	|| dc_yh >= SCREENHEIGHT)
+	I_Error ("R_DrawPrelitColumnLow: %i to %i at %i", dc_yl, dc_yh, dc_x);
+#endif
+
+    x = dc_x << 1;
+
+    dest = ylookup[dc_yl] + columnofs[x];
+    dest2 = ylookup[dc_yl] + columnofs[x+1];
+
+    fracstep = dc_iscale;
+    frac = dc_texturemid + (dc_yl-centery)*fracstep;
+
+    do
+    {
+	*dest2 = *dest = dc_source[(frac>>FRACBITS)&127];
+
+	dest += dc_pitch;
+	dest2 += dc_pitch;
+	frac += fracstep;
+
+    } while (count--);
+}
+
+void R_DrawPrelitSpan (void)
+{
+    unsigned int	position, step;
+    unsigned int	xtemp, ytemp;
+    byte*		dest;
+    int			count;
+    int			spot;
+
+#ifdef RANGECHECK
+    if (ds_x2 < ds_x1
+	|| ds_x1<0
+	|| ds_x2>=SCREENWIDTH
+	|| (unsigned)ds_y>SCREENHEIGHT)
+    {
+	I_Error ("R_DrawPrelitSpan: %i to %i at %i", ds_x1, ds_x2, ds_y);
+    }
+#endif
+
+    // packed as in R_DrawSpan
+    position = ((ds_xfrac << 10) & 0xffff0000)
+             | ((ds_yfrac >> 6)  & 0x0000ffff);
+    step = ((ds_xstep << 10) & 0xffff0000)
+         | ((ds_ystep >> 6)  & 0x0000ffff);
+
+    dest = ylookup[ds_y] + columnofs[ds_x1];
+    count = ds_x2 - ds_x1;
+
+    do
+    {
+        ytemp = (position >> 4) & 0x0fc0;
+        xtemp = (position >> 26);
+        spot = xtemp | ytemp;
+
+	*dest = ds_source[spot];
+	dest += ds_pitch;
+
+        position += step;
+
+    } while (count--);
+}
+
+void R_DrawPrelitSpanLow (void)
+{
+    unsigned int	position, step;
+    unsigned int	xtemp, ytemp;
+    byte*		dest;
+    int			count;
+    int			spot;
+
+#ifdef RANGECHECK
+    if (ds_x2 < ds_x1
+	|| ds_x1<0
+	|| ds_x2>=SCREENWIDTH
+	|| (unsigned)ds_y>SCREENHEIGHT)
+    {
+	I_Error ("R_DrawPrelitSpanLow: %i to %i at %i", ds_x1, ds_x2, ds_y);
+    }
+#endif
+
+    position = ((ds_xfrac << 10) & 0xffff0000)
+             | ((ds_yfrac >> 6)  & 0x0000ffff);
+    step = ((ds_xstep << 10) & 0xffff0000)
+         | ((ds_ystep >> 6)  & 0x0000ffff);
+
+    count = ds_x2 - ds_x1;
+
+    // as R_DrawSpanLow, which leaves ds_x1 and ds_x2 doubled
+    ds_x1 <<= 1;
+    ds_x2 <<= 1;
+
+    dest = ylookup[ds_y] + columnofs[ds_x1];
+
+    do
+    {
+        ytemp = (position >> 4) & 0x0fc0;
+        xtemp = (position >> 26);
+        spot = xtemp | ytemp;
+
+	*dest = ds_source[spot];
+	dest += ds_pitch;
+	*dest = ds_source[spot];
+	dest += ds_pitch;
+
+	position += step;
+
+    } while (count--);
+}
+
+
+static prelit_t **HashChain (int source, int light)
+{
+    return &hashtable[((unsigned int) source * 31 + light) & (HASHSIZE-1)];
+}
+
+static prelit_t *FindEntry (int source, int light)
+{
+    prelit_t*		entry;
+
+    for (entry = *HashChain(source, light); entry; entry = entry->hashnext)
+    {
+	if (entry->source == source && entry->light == light)
+	    return entry;
+    }
+
+    return NULL;
+}
+
+static void LinkFirst (prelit_t* entry)
+{
+    entry->prev = &lru;
+    entry->next = lru.next;
+    lru.next->prev = entry;
+    lru.next = entry;
+}
+
+static void Unlink (prelit_t* entry)
+{
+    entry->prev->next = entry->next;
+    entry->next->prev = entry->prev;
+}
+
+// Moves an entry to the front, once a frame is enough to keep
+//  those drawn this frame ahead of the rest.
+
+static void Touch (prelit_t* entry)
+{
+    if (entry->lastframe == framecount)
+	return;
+
+    Unlink(entry);
+    LinkFirst(entry);
+    entry->lastframe = framecount;
+}
+
+static void FreeEntry (prelit_t* entry)
+{
+    prelit_t**		link;
+
+    link = HashChain(entry->source, entry->light);
+
+    while (*link != entry)
+	link = &(*link)->hashnext;
+
+    *link = entry->hashnext;
+
+    Unlink(entry);
+    used -= entry->size;
+    free(entry);
+}
+
+static prelit_t *NewEntry (int source, int light,
+			   int datasize, int builtsize)
+{
+    prelit_t*		entry;
+    prelit_t**		chain;
+    size_t		size;
+
+    size = sizeof(*entry) + builtsize + datasize;
+
+    while (used + size > budget)
+    {
+	entry = lru.prev;
+
+	if (entry == &lru || entry->lastframe == framecount)
+	    return NULL;
+
+	FreeEntry(entry);
+    }
+
+    entry = malloc(size);
+
+    if (entry == NULL)
+	return NULL;
+
+    entry->source = source;
+    entry->light = light;
+    entry->lastframe = framecount;
+    entry->size = size;
+    entry->built = builtsize ? (byte *) (entry + 1) : NULL;
+    entry->data = (byte *) (entry + 1) + builtsize;
+
+    if (entry->built)
+	memset(entry->built, 0, builtsize);
+
+    chain = HashChain(source, light);
+    entry->hashnext = *chain;
+    *chain = entry;
+
+    LinkFirst(entry);
+    used += size;
+
+    return entry;
+}
+
+
+//
+// R_PrelitColumn
+//
+byte* R_PrelitColumn (int tex, int col, lighttable_t* colormap)
+{
+    prelit_t*		entry;
+    byte*		source;
+    byte*		dest;
+    int			light;
+    int			width;
+    int			i;
+
+    if (!budget)
+	return NULL;
+
+    if (!texturefits[tex])
+    {
+	texturefits[tex] = R_ColumnsFitLump(tex, COLUMNTEXELS) ? 1 : -1;
+    }
+
+    if (texturefits[tex] < 0)
+    {
+	prelitstats.misses++;
+	return NULL;
+    }
+
+    light = (colormap - colormaps) >> 8;
+    entry = FindEntry(tex, light);
+
+    if (entry)
+    {
+	Touch(entry);
+    }
+    else
+    {
+	width = texturewidthmask[tex] + 1;
+	entry = NewEntry(tex, light, width * COLUMNTEXELS, width);
+
+	if (!entry)
+	{
+	    prelitstats.misses++;
+	    return NULL;
+	}
+    }
+
+    col &= texturewidthmask[tex];
+    dest = entry->data + col * COLUMNTEXELS;
+
+    if (entry->built[col])
+    {
+	prelitstats.hits++;
+	return dest;
+    }
+
+    source = R_GetColumn(tex, col);
+
+    for (i = 0; i < COLUMNTEXELS; ++i)
+    {
+	dest[i] = colormap[source[i]];
+    }
+
+    entry->built[col] = 1;
+    prelitstats.misses++;
+
+    return dest;
+}
+
+
+//
+// R_PrelitFlat
+//
+byte* R_PrelitFlat (int lump, byte* source, lighttable_t* colormap)
+{
+    prelit_t*		entry;
+    int			light;
+    int			i;
+
+    if (!budget)
+	return NULL;
+
+    light = (colormap - colormaps) >> 8;
+    entry = FindEntry(-1 - lump, light);
+
+    if (entry)
+    {
+	Touch(entry);
+	prelitstats.hits++;
+	return entry->data;
+    }
+
+    prelitstats.misses++;
+
+    // the span drawers read a whole 64x64 tile
+    if (W_LumpLength(lump) < FLATTEXELS)
+	return NULL;
+
+    entry = NewEntry(-1 - lump, light, FLATTEXELS, 0);
+
+    if (!entry)
+	return NULL;
+
+    for (i = 0; i < FLATTEXELS; ++i)
+    {
+	entry->data[i] = colormap[source[i]];
+    }
+
+    return entry->data;
+}
+
+
+//
+// R_InitPrelit
+//
+void R_InitPrelit (void)
+{
+    int			p;
+    int			mb;
+
+    lru.next = lru.prev = &lru;
+
+    //!
+    // @arg <mb>
+    // @category video
+    //
+    // Keep up to mb megabytes of wall textures and flats with their
+    // lighting applied, so that they are drawn with one lookup a
+    // pixel rather than two. The picture is the same.
+    //
+
+    p = M_CheckParmWithArgs("-prelit", 1);
+
+    if (!p)
+	return;
+
+    mb = atoi(myargv[p + 1]);
+
+    if (mb <= 0)
+	return;
+
+    budget = (size_t) mb << 20;
+
+    texturefits = Z_Malloc(numtextures * sizeof(*texturefits),
+			   PU_STATIC, NULL);
+    memset(texturefits, 0, numtextures * sizeof(*texturefits));
+}
@@ -0,0 +1,49 @@
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Prelit texture cache: wall textures and flats with a colormap
+//	 already applied.
+//
+
+
+#ifndef __R_PRELIT__
+#define __R_PRELIT__
+
+// Columns and spans looked up, counted for the benchmark report.
+typedef struct
+{
+    int		hits;
+    int		misses;
+} prelitstats_t;
+
+extern prelitstats_t	prelitstats;
+
+// The drawers for prelit sources, which skip the colormap.
+void	R_DrawPrelitColumn (void);
+void	R_DrawPrelitColumnLow (void);
+void	R_DrawPrelitSpan (void);
+void	R_DrawPrelitSpanLow (void);
+
+// Returns the column of a wall texture lit with colormap,
+//  or NULL if it is not cached.
+byte*	R_PrelitColumn (int tex, int col, lighttable_t* colormap);
+
+// Returns a flat lit with colormap, or NULL if it is not cached.
+byte*	R_PrelitFlat (int lump, byte* source, lighttable_t* colormap);
+
+// Reads -prelit, after R_InitData.
+void	R_InitPrelit (void);
+
+#endif
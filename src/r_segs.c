@@ -25,6 +25,7 @@
 #include <stdlib.h>
 
 #include "i_system.h"
+#include "m_profile.h"
 
 #include "doomdef.h"
 #include "doomstat.h"
@@ -161,8 +162,8 @@ R_RenderMaskedSegRange
 	    {
 		index = spryscale>>LIGHTSCALESHIFT;
 
-		if (index >=  MAXLIGHTSCALE )
-		    index = MAXLIGHTSCALE-1;
+		if (index >=  maxlightscale )
+		    index = maxlightscale-1;
 
 		dc_colormap = walllights[index];
 	    }
@@ -184,6 +185,28 @@ R_RenderMaskedSegRange
 
 
 
+//
+// R_DrawWallColumn
+// SOKOL CHANGE: draws from the prelit cache when it has the column.
+//
+static void R_DrawWallColumn (int texture, int texturecolumn)
+{
+    byte*	prelit;
+
+    prelit = R_PrelitColumn (texture, texturecolumn, dc_colormap);
+
+    if (prelit)
+    {
+	dc_source = prelit;
+	prelitcolfunc ();
+    }
+    else
+    {
+	dc_source = R_GetColumn (texture, texturecolumn);
+	colfunc ();
+    }
+}
+
 
 //
 // R_RenderSegLoop
@@ -261,8 +284,8 @@ void R_RenderSegLoop (void)
 	    // calculate lighting
 	    index = rw_scale>>LIGHTSCALESHIFT;
 
-	    if (index >=  MAXLIGHTSCALE )
-		index = MAXLIGHTSCALE-1;
+	    if (index >=  maxlightscale )
+		index = maxlightscale-1;
 
 	    dc_colormap = walllights[index];
 	    dc_x = rw_x;
@@ -282,8 +305,7 @@ void R_RenderSegLoop (void)
 	    dc_yl = yl;
 	    dc_yh = yh;
 	    dc_texturemid = rw_midtexturemid;
-	    dc_source = R_GetColumn(midtexture,texturecolumn);
-	    colfunc ();
+	    R_DrawWallColumn (midtexture, texturecolumn);
 	    ceilingclip[rw_x] = viewheight;
 	    floorclip[rw_x] = -1;
 	}
@@ -304,8 +326,7 @@ void R_RenderSegLoop (void)
 		    dc_yl = yl;
 		    dc_yh = mid;
 		    dc_texturemid = rw_toptexturemid;
-		    dc_source = R_GetColumn(toptexture,texturecolumn);
-		    colfunc ();
+		    R_DrawWallColumn (toptexture, texturecolumn);
 		    ceilingclip[rw_x] = mid;
 		}
 		else
@@ -333,9 +354,7 @@ void R_RenderSegLoop (void)
 		    dc_yl = mid;
 		    dc_yh = yh;
 		    dc_texturemid = rw_bottomtexturemid;
-		    dc_source = R_GetColumn(bottomtexture,
-					    texturecolumn);
-		    colfunc ();
+		    R_DrawWallColumn (bottomtexture, texturecolumn);
 		    floorclip[rw_x] = mid;
 		}
 		else
@@ -381,9 +400,12 @@ R_StoreWallRange
     fixed_t		vtop;
     int			lightnum;
 
-    // don't overflow and crash
-    if (ds_p == &drawsegs[MAXDRAWSEGS])
-	return;		
+    // SOKOL CHANGE: make room instead of dropping the wall, the
+    //  openings for maskedtexturecol and the sprite clips included.
+    if (ds_p == drawsegs + maxdrawsegs)
+	R_GrowDrawSegs ();
+
+    R_CheckOpenings (3 * (stop - start + 1));
 		
 #ifdef RANGECHECK
     if (start >=viewwidth || start > stop)
@@ -710,7 +732,9 @@ R_StoreWallRange
     if (markfloor)
 	floorplane = R_CheckPlane (floorplane, rw_x, rw_stopx-1);
 
+    PROFILE_BEGIN ("R_RenderSegLoop");
     R_RenderSegLoop ();
+    PROFILE_END ();
 
     
     // save sprite clipping info
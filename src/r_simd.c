@@ -0,0 +1,732 @@
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	SIMD versions of the column and span drawers, picked
+//	 for the CPU at startup.
+//
+// The drawers work out the texture coordinates of several pixels at
+// once and write them out together, which needs the pixels to be next
+// to each other in memory: spans in the normal screen layout, columns
+// with -colmajor. The other drawer of each pair stays the C one, so
+// are the low detail, fuzz and translated drawers. The texel and the
+// colormap lookups are the same as in r_draw.c, the picture is the
+// same with and without them.
+//
+// AVX2 is checked for at run time and looks up with gathers. These
+// read the 32 bits ending at the byte wanted, so that they never read
+// past the end of a flat or the colormaps; there always is a lump, a
+// zone block header or a prelit cache entry before them. SSE2 and NEON
+// work out the coordinates in vectors and look up one pixel at a time.
+//
+// The drawers for the prelit cache (see r_prelit.c) are the same ones
+// without the colormap lookup.
+//
+// The flats drawn column by column with -colmajor step eight rows at
+// once with AVX2. Looking them up one pixel at a time, as SSE2 and
+// NEON would, was no faster than the C drawer, so there are none.
+//
+
+
+#include "doomdef.h"
+
+#include "m_argv.h"
+
+#include "r_local.h"
+#include "r_simd.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) \
+ || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMD_SSE2
+#include <emmintrin.h>
+
+#if (defined(__GNUC__) || defined(_MSC_VER)) && !defined(__EMSCRIPTEN__)
+#define SIMD_AVX2
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2	__attribute__((target("avx2")))
+#endif
+#endif
+
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+
+void			(*simdcolfunc) (void) = R_DrawColumn;
+void			(*simdspanfunc) (void) = R_DrawSpan;
+void			(*simdprelitcolfunc) (void) = R_DrawPrelitColumn;
+void			(*simdprelitspanfunc) (void) = R_DrawPrelitSpan;
+void			(*simdplanecolfunc) (void) = R_DrawPlaneColumn;
+
+
+// Same as in R_DrawSpan: x and y packed into one 32-bit word, each
+//  with 6 bits of integer and 10 bits of fraction.
+
+#define SPANPOSITION()	(((ds_xfrac << 10) & 0xffff0000) \
+			 | ((ds_yfrac >> 6)  & 0x0000ffff))
+#define SPANSTEP()	(((ds_xstep << 10) & 0xffff0000) \
+			 | ((ds_ystep >> 6)  & 0x0000ffff))
+#define SPANSPOT(p)	((((p) >> 4) & 0x0fc0) | ((p) >> 26))
+
+// The drawers are shared with the prelit ones, which pass no colormap.
+
+#define LIGHT(colormap, texel)	((colormap) ? (colormap)[texel] : (texel))
+
+
+#ifdef SIMD_SSE2
+
+// Two pixels looked up from lanes n and n+1 of eight packed
+//  texture offsets, for _mm_insert_epi16.
+
+#define LOOKUPPAIR(v, n) \
+    (LIGHT (colormap, source[_mm_extract_epi16 (v, n)]) \
+     | (LIGHT (colormap, source[_mm_extract_epi16 (v, n + 1)]) << 8))
+
+static __m128i LookupSixteen (__m128i lo, __m128i hi,
+			      byte* source, byte* colormap)
+{
+    __m128i	pixels;
+
+    pixels = _mm_cvtsi32_si128 (LOOKUPPAIR (lo, 0));
+    pixels = _mm_insert_epi16 (pixels, LOOKUPPAIR (lo, 2), 1);
+    pixels = _mm_insert_epi16 (pixels, LOOKUPPAIR (lo, 4), 2);
+    pixels = _mm_insert_epi16 (pixels, LOOKUPPAIR (lo, 6), 3);
+    pixels = _mm_insert_epi16 (pixels, LOOKUPPAIR (hi, 0), 4);
+    pixels = _mm_insert_epi16 (pixels, LOOKUPPAIR (hi, 2), 5);
+    pixels = _mm_insert_epi16 (pixels, LOOKUPPAIR (hi, 4), 6);
+    pixels = _mm_insert_epi16 (pixels, LOOKUPPAIR (hi, 6), 7);
+
+    return pixels;
+}
+
+static void DrawSpanSSE2 (byte* colormap)
+{
+    unsigned int	position;
+    unsigned int	step;
+    byte*		source;
+    byte*		dest;
+    int			count;
+    int			i;
+    __m128i		pos[4];
+    __m128i		spot[4];
+    __m128i		step4;
+    __m128i		step16;
+    __m128i		mask;
+
+    position = SPANPOSITION ();
+    step = SPANSTEP ();
+
+    source = ds_source;
+    dest = ylookup[ds_y] + columnofs[ds_x1];
+    count = ds_x2 - ds_x1 + 1;
+
+    if (count >= 16)
+    {
+	pos[0] = _mm_setr_epi32 (position, position + step,
+				 position + step*2, position + step*3);
+	step4 = _mm_set1_epi32 (step*4);
+	step16 = _mm_set1_epi32 (step*16);
+	mask = _mm_set1_epi32 (0x0fc0);
+
+	for (i=1 ; i<4 ; i++)
+	    pos[i] = _mm_add_epi32 (pos[i-1], step4);
+
+	do
+	{
+	    for (i=0 ; i<4 ; i++)
+	    {
+		spot[i] = _mm_or_si128 (_mm_and_si128 (_mm_srli_epi32 (pos[i], 4),
+						       mask),
+					_mm_srli_epi32 (pos[i], 26));
+		pos[i] = _mm_add_epi32 (pos[i], step16);
+	    }
+
+	    // The offsets are below 4096, so they pack without saturating.
+	    _mm_storeu_si128 ((__m128i *) dest,
+			      LookupSixteen (_mm_packs_epi32 (spot[0], spot[1]),
+					     _mm_packs_epi32 (spot[2], spot[3]),
+					     source, colormap));
+
+	    position += step*16;
+	    dest += 16;
+	    count -= 16;
+	} while (count >= 16);
+    }
+
+    while (count-- > 0)
+    {
+	*dest++ = LIGHT (colormap, source[SPANSPOT (position)]);
+	position += step;
+    }
+}
+
+static void R_DrawSpanSSE2 (void)
+{
+    DrawSpanSSE2 (ds_colormap);
+}
+
+static void R_DrawPrelitSpanSSE2 (void)
+{
+    DrawSpanSSE2 (NULL);
+}
+
+static void DrawColumnSSE2 (byte* colormap)
+{
+    int			count;
+    byte*		source;
+    byte*		dest;
+    fixed_t		frac;
+    fixed_t		fracstep;
+    int			i;
+    __m128i		fracs[4];
+    __m128i		index[4];
+    __m128i		step4;
+    __m128i		step16;
+    __m128i		mask;
+
+    count = dc_yh - dc_yl + 1;
+
+    if (count <= 0)
+	return;
+
+    source = dc_source;
+    dest = ylookup[dc_yl] + columnofs[dc_x];
+
+    fracstep = dc_iscale;
+    frac = dc_texturemid + (dc_yl-centery)*fracstep;
+
+    if (count >= 16)
+    {
+	fracs[0] = _mm_setr_epi32 (frac, frac + fracstep,
+				   frac + fracstep*2, frac + fracstep*3);
+	step4 = _mm_set1_epi32 (fracstep*4);
+	step16 = _mm_set1_epi32 (fracstep*16);
+	mask = _mm_set1_epi32 (127);
+
+	for (i=1 ; i<4 ; i++)
+	    fracs[i] = _mm_add_epi32 (fracs[i-1], step4);
+
+	do
+	{
+	    for (i=0 ; i<4 ; i++)
+	    {
+		index[i] = _mm_and_si128 (_mm_srli_epi32 (fracs[i], FRACBITS),
+					  mask);
+		fracs[i] = _mm_add_epi32 (fracs[i], step16);
+	    }
+
+	    _mm_storeu_si128 ((__m128i *) dest,
+			      LookupSixteen (_mm_packs_epi32 (index[0], index[1]),
+					     _mm_packs_epi32 (index[2], index[3]),
+					     source, colormap));
+
+	    frac += fracstep*16;
+	    dest += 16;
+	    count -= 16;
+	} while (count >= 16);
+    }
+
+    while (count-- > 0)
+    {
+	*dest++ = LIGHT (colormap, source[(frac>>FRACBITS)&127]);
+	frac += fracstep;
+    }
+}
+
+static void R_DrawColumnSSE2 (void)
+{
+    DrawColumnSSE2 (dc_colormap);
+}
+
+static void R_DrawPrelitColumnSSE2 (void)
+{
+    DrawColumnSSE2 (NULL);
+}
+
+#endif
+
+
+#ifdef SIMD_AVX2
+
+// Looks up eight bytes with gathers, each reading the dword which
+//  ends at the byte, see above.
+
+TARGET_AVX2
+static __m256i GatherBytes (byte* base, __m256i offsets)
+{
+    return _mm256_srli_epi32 (_mm256_i32gather_epi32 ((const int *) (base - 3),
+						       offsets, 1), 24);
+}
+
+// Packs the low bytes of eight dwords and stores them.
+
+TARGET_AVX2
+static void StoreEight (byte* dest, __m256i pixels)
+{
+    __m256i	pick;
+
+    pick = _mm256_setr_epi8 (0, 4, 8, 12, -1, -1, -1, -1,
+			     -1, -1, -1, -1, -1, -1, -1, -1,
+			     0, 4, 8, 12, -1, -1, -1, -1,
+			     -1, -1, -1, -1, -1, -1, -1, -1);
+    pixels = _mm256_shuffle_epi8 (pixels, pick);
+
+    _mm_storel_epi64 ((__m128i *) dest,
+		      _mm_unpacklo_epi32 (_mm256_castsi256_si128 (pixels),
+					  _mm256_extracti128_si256 (pixels, 1)));
+}
+
+TARGET_AVX2
+static void DrawSpanAVX2 (byte* colormap)
+{
+    unsigned int	position;
+    unsigned int	step;
+    byte*		source;
+    byte*		dest;
+    int			count;
+    __m256i		pos;
+    __m256i		spot;
+    __m256i		step8;
+    __m256i		mask;
+    __m256i		pixels;
+
+    position = SPANPOSITION ();
+    step = SPANSTEP ();
+
+    source = ds_source;
+    dest = ylookup[ds_y] + columnofs[ds_x1];
+    count = ds_x2 - ds_x1 + 1;
+
+    if (count >= 8)
+    {
+	pos = _mm256_add_epi32 (_mm256_set1_epi32 (position),
+				_mm256_mullo_epi32 (_mm256_set1_epi32 (step),
+						    _mm256_setr_epi32 (0, 1, 2, 3,
+								       4, 5, 6, 7)));
+	step8 = _mm256_set1_epi32 (step*8);
+	mask = _mm256_set1_epi32 (0x0fc0);
+
+	do
+	{
+	    spot = _mm256_or_si256 (_mm256_and_si256 (_mm256_srli_epi32 (pos, 4),
+						      mask),
+				    _mm256_srli_epi32 (pos, 26));
+	    pixels = GatherBytes (source, spot);
+
+	    if (colormap)
+		pixels = GatherBytes (colormap, pixels);
+
+	    StoreEight (dest, pixels);
+
+	    pos = _mm256_add_epi32 (pos, step8);
+	    position += step*8;
+	    dest += 8;
+	    count -= 8;
+	} while (count >= 8);
+    }
+
+    while (count-- > 0)
+    {
+	*dest++ = LIGHT (colormap, source[SPANSPOT (position)]);
+	position += step;
+    }
+}
+
+TARGET_AVX2
+static void R_DrawSpanAVX2 (void)
+{
+    DrawSpanAVX2 (ds_colormap);
+}
+
+TARGET_AVX2
+static void R_DrawPrelitSpanAVX2 (void)
+{
+    DrawSpanAVX2 (NULL);
+}
+
+TARGET_AVX2
+static void DrawColumnAVX2 (byte* colormap)
+{
+    int			count;
+    byte*		source;
+    byte*		dest;
+    fixed_t		frac;
+    fixed_t		fracstep;
+    __m256i		fracs;
+    __m256i		index;
+    __m256i		step8;
+    __m256i		mask;
+    __m256i		pixels;
+
+    count = dc_yh - dc_yl + 1;
+
+    if (count <= 0)
+	return;
+
+    source = dc_source;
+    dest = ylookup[dc_yl] + columnofs[dc_x];
+
+    fracstep = dc_iscale;
+    frac = dc_texturemid + (dc_yl-centery)*fracstep;
+
+    if (count >= 8)
+    {
+	fracs = _mm256_add_epi32 (_mm256_set1_epi32 (frac),
+				  _mm256_mullo_epi32 (_mm256_set1_epi32 (fracstep),
+						      _mm256_setr_epi32 (0, 1, 2, 3,
+									 4, 5, 6, 7)));
+	step8 = _mm256_set1_epi32 (fracstep*8);
+	mask = _mm256_set1_epi32 (127);
+
+	do
+	{
+	    index = _mm256_and_si256 (_mm256_srli_epi32 (fracs, FRACBITS), mask);
+	    pixels = GatherBytes (source, index);
+
+	    if (colormap)
+		pixels = GatherBytes (colormap, pixels);
+
+	    StoreEight (dest, pixels);
+
+	    fracs = _mm256_add_epi32 (fracs, step8);
+	    frac += fracstep*8;
+	    dest += 8;
+	    count -= 8;
+	} while (count >= 8);
+    }
+
+    while (count-- > 0)
+    {
+	*dest++ = LIGHT (colormap, source[(frac>>FRACBITS)&127]);
+	frac += fracstep;
+    }
+}
+
+TARGET_AVX2
+static void R_DrawColumnAVX2 (void)
+{
+    DrawColumnAVX2 (dc_colormap);
+}
+
+TARGET_AVX2
+static void R_DrawPrelitColumnAVX2 (void)
+{
+    DrawColumnAVX2 (NULL);
+}
+
+// Each lane is a row of the flat with its own span and colormap,
+//  see R_DrawPlaneColumn.
+
+TARGET_AVX2
+static void R_DrawPlaneColumnAVX2 (void)
+{
+    unsigned int*	rowposition;
+    unsigned int*	rowstep;
+    int*		rowlight;
+    byte*		colormap;
+    unsigned int	position;
+    byte*		source;
+    byte*		dest;
+    int			y;
+    __m256i		pos;
+    __m256i		spot;
+    __m256i		mask;
+    __m256i		pixels;
+
+    // in locals, which the stores cannot alias
+    rowposition = ds_rowposition;
+    rowstep = ds_rowstep;
+    rowlight = ds_rowlight;
+    colormap = colormaps;
+    source = ds_source;
+    dest = ylookup[dc_yl] + columnofs[dc_x];
+    mask = _mm256_set1_epi32 (0x0fc0);
+
+    for (y = dc_yl; y + 8 <= dc_yh + 1; y += 8)
+    {
+	pos = _mm256_loadu_si256 ((__m256i *) (rowposition + y));
+	_mm256_storeu_si256 ((__m256i *) (rowposition + y),
+			     _mm256_add_epi32 (pos,
+					       _mm256_loadu_si256 ((__m256i *) (rowstep + y))));
+
+	spot = _mm256_or_si256 (_mm256_and_si256 (_mm256_srli_epi32 (pos, 4),
+						  mask),
+				_mm256_srli_epi32 (pos, 26));
+	pixels = GatherBytes (source, spot);
+	pixels = _mm256_add_epi32 (pixels,
+				   _mm256_loadu_si256 ((__m256i *) (rowlight + y)));
+	pixels = GatherBytes (colormap, pixels);
+
+	StoreEight (dest, pixels);
+	dest += 8;
+    }
+
+    for ( ; y <= dc_yh; y++)
+    {
+	position = rowposition[y];
+	rowposition[y] = position + rowstep[y];
+
+	*dest++ = colormap[rowlight[y] + source[SPANSPOT (position)]];
+    }
+}
+
+static boolean CPUHasAVX2 (void)
+{
+#ifdef _MSC_VER
+    int		regs[4];
+
+    // AVX2 and AVX, and the OS saving the YMM registers.
+    __cpuidex (regs, 7, 0);
+
+    if (!(regs[1] & (1 << 5)))
+	return false;
+
+    __cpuidex (regs, 1, 0);
+
+    if (!(regs[2] & (1 << 27)) || !(regs[2] & (1 << 28)))
+	return false;
+
+    return (_xgetbv (0) & 6) == 6;
+#else
+    return __builtin_cpu_supports ("avx2") != 0;
+#endif
+}
+
+#endif
+
+
+#ifdef SIMD_NEON
+
+static void DrawSpanNEON (byte* colormap)
+{
+    unsigned int	position;
+    unsigned int	step;
+    byte*		source;
+    byte*		dest;
+    int			count;
+    int			i;
+    uint32_t		spots[16];
+    uint8_t		pixels[16];
+    uint32x4_t		pos[4];
+    uint32x4_t		step16;
+    uint32x4_t		mask;
+
+    position = SPANPOSITION ();
+    step = SPANSTEP ();
+
+    source = ds_source;
+    dest = ylookup[ds_y] + columnofs[ds_x1];
+    count = ds_x2 - ds_x1 + 1;
+
+    if (count >= 16)
+    {
+	for (i=0 ; i<16 ; i++)
+	    spots[i] = position + step*i;
+
+	for (i=0 ; i<4 ; i++)
+	    pos[i] = vld1q_u32 (spots + i*4);
+
+	step16 = vdupq_n_u32 (step*16);
+	mask = vdupq_n_u32 (0x0fc0);
+
+	do
+	{
+	    for (i=0 ; i<4 ; i++)
+	    {
+		vst1q_u32 (spots + i*4,
+			   vorrq_u32 (vandq_u32 (vshrq_n_u32 (pos[i], 4), mask),
+				      vshrq_n_u32 (pos[i], 26)));
+		pos[i] = vaddq_u32 (pos[i], step16);
+	    }
+
+	    for (i=0 ; i<16 ; i++)
+		pixels[i] = LIGHT (colormap, source[spots[i]]);
+
+	    vst1q_u8 (dest, vld1q_u8 (pixels));
+
+	    position += step*16;
+	    dest += 16;
+	    count -= 16;
+	} while (count >= 16);
+    }
+
+    while (count-- > 0)
+    {
+	*dest++ = LIGHT (colormap, source[SPANSPOT (position)]);
+	position += step;
+    }
+}
+
+static void R_DrawSpanNEON (void)
+{
+    DrawSpanNEON (ds_colormap);
+}
+
+static void R_DrawPrelitSpanNEON (void)
+{
+    DrawSpanNEON (NULL);
+}
+
+static void DrawColumnNEON (byte* colormap)
+{
+    int			count;
+    byte*		source;
+    byte*		dest;
+    fixed_t		frac;
+    fixed_t		fracstep;
+    int			i;
+    int32_t		index[16];
+    uint8_t		pixels[16];
+    int32x4_t		fracs[4];
+    int32x4_t		step16;
+    int32x4_t		mask;
+
+    count = dc_yh - dc_yl + 1;
+
+    if (count <= 0)
+	return;
+
+    source = dc_source;
+    dest = ylookup[dc_yl] + columnofs[dc_x];
+
+    fracstep = dc_iscale;
+    frac = dc_texturemid + (dc_yl-centery)*fracstep;
+
+    if (count >= 16)
+    {
+	for (i=0 ; i<16 ; i++)
+	    index[i] = frac + fracstep*i;
+
+	for (i=0 ; i<4 ; i++)
+	    fracs[i] = vld1q_s32 (index + i*4);
+
+	step16 = vdupq_n_s32 (fracstep*16);
+	mask = vdupq_n_s32 (127);
+
+	do
+	{
+	    for (i=0 ; i<4 ; i++)
+	    {
+		vst1q_s32 (index + i*4,
+			   vandq_s32 (vshrq_n_s32 (fracs[i], FRACBITS), mask));
+		fracs[i] = vaddq_s32 (fracs[i], step16);
+	    }
+
+	    for (i=0 ; i<16 ; i++)
+		pixels[i] = LIGHT (colormap, source[index[i]]);
+
+	    vst1q_u8 (dest, vld1q_u8 (pixels));
+
+	    frac += fracstep*16;
+	    dest += 16;
+	    count -= 16;
+	} while (count >= 16);
+    }
+
+    while (count-- > 0)
+    {
+	*dest++ = LIGHT (colormap, source[(frac>>FRACBITS)&127]);
+	frac += fracstep;
+    }
+}
+
+static void R_DrawColumnNEON (void)
+{
+    DrawColumnNEON (dc_colormap);
+}
+
+static void R_DrawPrelitColumnNEON (void)
+{
+    DrawColumnNEON (NULL);
+}
+
+#endif
+
+
+//
+// R_InitSIMD
+//
+void R_InitSIMD (void)
+{
+    void	(*column) (void) = NULL;
+    void	(*span) (void) = NULL;
+    void	(*prelitcolumn) (void) = NULL;
+    void	(*prelitspan) (void) = NULL;
+    void	(*planecolumn) (void) = NULL;
+
+    //!
+    // @category video
+    //
+    // Draw with the C column and span drawers only, even if the CPU
+    // has SIMD instructions for them. The picture is the same.
+    //
+
+    if (M_CheckParm ("-nosimd"))
+	return;
+
+#if defined(SIMD_AVX2)
+    if (CPUHasAVX2 ())
+    {
+	column = R_DrawColumnAVX2;
+	span = R_DrawSpanAVX2;
+	prelitcolumn = R_DrawPrelitColumnAVX2;
+	prelitspan = R_DrawPrelitSpanAVX2;
+	planecolumn = R_DrawPlaneColumnAVX2;
+    }
+    else
+    {
+	column = R_DrawColumnSSE2;
+	span = R_DrawSpanSSE2;
+	prelitcolumn = R_DrawPrelitColumnSSE2;
+	prelitspan = R_DrawPrelitSpanSSE2;
+    }
+#elif defined(SIMD_SSE2)
+    column = R_DrawColumnSSE2;
+    span = R_DrawSpanSSE2;
+    prelitcolumn = R_DrawPrelitColumnSSE2;
+    prelitspan = R_DrawPrelitSpanSSE2;
+#elif defined(SIMD_NEON)
+    column = R_DrawColumnNEON;
+    span = R_DrawSpanNEON;
+    prelitcolumn = R_DrawPrelitColumnNEON;
+    prelitspan = R_DrawPrelitSpanNEON;
+#endif
+
+    // Only the drawer writing along the buffer gains anything.
+
+    if (colmajor)
+    {
+	if (column != NULL)
+	{
+	    simdcolfunc = column;
+	    simdprelitcolfunc = prelitcolumn;
+	}
+
+	if (planecolumn != NULL)
+	    simdplanecolfunc = planecolumn;
+    }
+    else
+    {
+	if (span != NULL)
+	{
+	    simdspanfunc = span;
+	    simdprelitspanfunc = prelitspan;
+	}
+    }
+}
@@ -0,0 +1,41 @@
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	SIMD versions of the column and span drawers, picked
+//	 for the CPU at startup.
+//
+
+
+#ifndef __R_SIMD__
+#define __R_SIMD__
+
+// The full detail column and span drawers, R_DrawColumn and
+//  R_DrawSpan unless R_InitSIMD found faster ones.
+extern void		(*simdcolfunc) (void);
+extern void		(*simdspanfunc) (void);
+
+// The same for prelit sources, R_DrawPrelitColumn and R_DrawPrelitSpan
+//  unless there are faster ones.
+extern void		(*simdprelitcolfunc) (void);
+extern void		(*simdprelitspanfunc) (void);
+
+// The column by column flat drawer for -colmajor, R_DrawPlaneColumn
+//  unless there is a faster one.
+extern void		(*simdplanecolfunc) (void);
+
+// Checks the CPU and reads -nosimd, after R_InitViewBuffer.
+void R_InitSIMD (void);
+
+#endif
@@ -84,6 +84,22 @@ extern subsector_t*	subsectors;
 extern int		numnodes;
 extern node_t*		nodes;
 
+// SOKOL CHANGE: the nodes again in depth first order, to walk the tree
+// with a stack. The first child of a node comes right after it. The
+// partition lines are kept apart from the rest for the side tests, and
+// children are positions in this order or subsectors as in nodes.
+// bsproot is the whole tree, bspdepth the most nodes above a subsector.
+typedef fixed_t		bspbbox_t[2][4];
+
+extern int		bsproot;
+extern int		bspdepth;
+extern fixed_t*		bspx;
+extern fixed_t*		bspy;
+extern fixed_t*		bspdx;
+extern fixed_t*		bspdy;
+extern unsigned short*	bspchildren[2];
+extern bspbbox_t*	bspbbox;
+
 extern int		numlines;
 extern line_t*		lines;
 
@@ -106,7 +122,7 @@ extern player_t*	viewplayer;
 extern angle_t		clipangle;
 
 extern int		viewangletox[FINEANGLES/2];
-extern angle_t		xtoviewangle[SCREENWIDTH+1];
+extern angle_t*		xtoviewangle;
 //extern fixed_t		finetangent[FINEANGLES/2];
 
 extern fixed_t		rw_distance;
@@ -0,0 +1,610 @@
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Multithreaded drawing: columns and spans are queued by
+//	 screen strip and drawn by the render threads.
+//
+// The BSP walk, the planes and the sprites are worked out on the
+// main thread as before; only the drawers are replaced. Every column
+// and span they would draw is queued with the strip of the screen it
+// falls in, spans that cross strips are cut up. When the frame is
+// done the strips are handed out to the threads, which draw their
+// queues in the original order. Nothing draws across strips, so the
+// result is the same as drawing on one thread.
+//
+// With -sortdraw the walls of a strip, and then its flats, are drawn
+// grouped by texture and colormap instead, so each texture is read
+// while it is in the cache. No two walls cover the same pixel, nor do
+// two flats, so the order within each batch does not change the
+// picture. A flat can overdraw the edge of a wall, so the batches
+// stay in order, as do the sprites and masked walls after them.
+//
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "doomdef.h"
+
+#include "i_system.h"
+#include "i_thread.h"
+#include "m_argv.h"
+#include "w_wad.h"
+
+#include "r_local.h"
+#include "r_strip.h"
+
+// Strips line up with the cache lines of the frame buffer,
+//  so no two threads write to the same line.
+#define STRIPWIDTH		64
+
+typedef struct
+{
+    void		(*draw) (void);
+    boolean		isspan;
+
+    lighttable_t*	colormap;
+    byte*		source;
+
+    union
+    {
+	struct
+	{
+	    byte*	translation;
+	    int		x;
+	    int		yl;
+	    int		yh;
+	    fixed_t	iscale;
+	    fixed_t	texturemid;
+	    int		fuzzpos;
+	} column;
+
+	struct
+	{
+	    int		y;
+	    int		x1;
+	    int		x2;
+	    fixed_t	xfrac;
+	    fixed_t	yfrac;
+	    fixed_t	xstep;
+	    fixed_t	ystep;
+	} span;
+    } u;
+} drawcmd_t;
+
+// walls, and then flats
+#define MAXBATCHES		2
+
+// The order of a command when sorted.
+typedef struct
+{
+    unsigned int	key;
+    int			index;
+} sortkey_t;
+
+// Radix sort digits of the 30 bit keys.
+#define SORTBITS		10
+#define SORTPASSES		3
+
+typedef struct
+{
+    drawcmd_t*		cmds;
+    int			numcmds;
+    int			maxcmds;
+
+    // ends of the batches which can be drawn in any order,
+    //  at the start of the queue
+    int			batchends[MAXBATCHES];
+    int			numbatches;
+
+    sortkey_t*		keys;
+    int			maxkeys;
+} strip_t;
+
+boolean			stripdrawing;
+
+static int		numthreads = 1;
+
+// sort the walls and flats by texture
+static boolean		sortdraw;
+
+static strip_t*		strips;
+static int		numstrips;
+static int		maxstrips;
+
+// strip of the left edge of the view
+static int		firststrip;
+
+// the drawers for the view size, run by the threads
+static void		(*drawcolumn) (void);
+static void		(*drawfuzzcolumn) (void);
+static void		(*drawtranscolumn) (void);
+static void		(*drawspan) (void);
+static void		(*drawprelitcolumn) (void);
+static void		(*drawprelitspan) (void);
+
+
+static int StripOf (int x)
+{
+    return (viewwindowx + (x << detailshift)) / STRIPWIDTH - firststrip;
+}
+
+// First view column of a strip.
+
+static int StripStart (int strip)
+{
+    return ((strip + firststrip) * STRIPWIDTH - viewwindowx) >> detailshift;
+}
+
+static drawcmd_t *NewCmd (int s)
+{
+    strip_t*		strip;
+
+    strip = &strips[s];
+
+    if (strip->numcmds == strip->maxcmds)
+    {
+	strip->maxcmds = strip->maxcmds ? strip->maxcmds * 2 : 1024;
+	strip->cmds = realloc(strip->cmds,
+			      strip->maxcmds * sizeof(*strip->cmds));
+
+	if (strip->cmds == NULL)
+	{
+	    I_Error("NewCmd: failed to grow the queue of strip %i", s);
+	}
+    }
+
+    return &strip->cmds[strip->numcmds++];
+}
+
+
+//
+// Queueing drawers, these take the place of colfunc and spanfunc.
+//
+static drawcmd_t *AddColumn (void (*draw) (void))
+{
+    drawcmd_t*		cmd;
+
+    cmd = NewCmd(StripOf(dc_x));
+    cmd->draw = draw;
+    cmd->isspan = false;
+    cmd->colormap = dc_colormap;
+    cmd->source = dc_source;
+    cmd->u.column.translation = dc_translation;
+    cmd->u.column.x = dc_x;
+    cmd->u.column.yl = dc_yl;
+    cmd->u.column.yh = dc_yh;
+    cmd->u.column.iscale = dc_iscale;
+    cmd->u.column.texturemid = dc_texturemid;
+
+    return cmd;
+}
+
+static void QueueColumn (void)
+{
+    if (dc_yh >= dc_yl)
+	AddColumn(drawcolumn);
+}
+
+static void QueueTranslatedColumn (void)
+{
+    if (dc_yh >= dc_yl)
+	AddColumn(drawtranscolumn);
+}
+
+static void QueuePrelitColumn (void)
+{
+    if (dc_yh >= dc_yl)
+	AddColumn(drawprelitcolumn);
+}
+
+static void QueueFuzzColumn (void)
+{
+    drawcmd_t*		cmd;
+
+    // Adjust the borders as the fuzz drawers do,
+    //  fuzzpos moves on by one for each pixel.
+    if (!dc_yl)
+	dc_yl = 1;
+
+    if (dc_yh == viewheight-1)
+	dc_yh = viewheight - 2;
+
+    if (dc_yh < dc_yl)
+	return;
+
+    cmd = AddColumn(drawfuzzcolumn);
+    cmd->u.column.fuzzpos = fuzzpos;
+
+    fuzzpos = (fuzzpos + dc_yh - dc_yl + 1) % FUZZTABLE;
+}
+
+static void AddSpans (void (*draw) (void))
+{
+    drawcmd_t*		cmd;
+    unsigned int	position;
+    unsigned int	step;
+    int			first;
+    int			last;
+    int			s;
+
+    first = StripOf(ds_x1);
+    last = StripOf(ds_x2);
+
+    for (s = first; s <= last; ++s)
+    {
+	cmd = NewCmd(s);
+	cmd->draw = draw;
+	cmd->isspan = true;
+	cmd->colormap = ds_colormap;
+	cmd->source = ds_source;
+	cmd->u.span.y = ds_y;
+	cmd->u.span.x1 = s == first ? ds_x1 : StripStart(s);
+	cmd->u.span.x2 = s == last ? ds_x2 : StripStart(s + 1) - 1;
+	cmd->u.span.xfrac = ds_xfrac;
+	cmd->u.span.yfrac = ds_yfrac;
+	cmd->u.span.xstep = ds_xstep;
+	cmd->u.span.ystep = ds_ystep;
+
+	if (s != first)
+	{
+	    // The drawers step a packed position (see R_DrawSpan),
+	    //  step it as far as they would have and unpack it, so the
+	    //  rest of the span starts on the same texel.
+	    position = (((unsigned int) ds_xfrac << 10) & 0xffff0000)
+		     | ((ds_yfrac >> 6) & 0x0000ffff);
+	    step = (((unsigned int) ds_xstep << 10) & 0xffff0000)
+		 | ((ds_ystep >> 6) & 0x0000ffff);
+
+	    position += (unsigned int) (cmd->u.span.x1 - ds_x1) * step;
+
+	    cmd->u.span.xfrac = position >> 10;
+	    cmd->u.span.yfrac = (position & 0x0000ffff) << 6;
+	}
+    }
+}
+
+static void QueueSpan (void)
+{
+    AddSpans(drawspan);
+}
+
+static void QueuePrelitSpan (void)
+{
+    AddSpans(drawprelitspan);
+}
+
+
+static void DrawCmd (drawcmd_t* cmd)
+{
+    if (cmd->isspan)
+    {
+	ds_colormap = cmd->colormap;
+	ds_source = cmd->source;
+	ds_y = cmd->u.span.y;
+	ds_x1 = cmd->u.span.x1;
+	ds_x2 = cmd->u.span.x2;
+	ds_xfrac = cmd->u.span.xfrac;
+	ds_yfrac = cmd->u.span.yfrac;
+	ds_xstep = cmd->u.span.xstep;
+	ds_ystep = cmd->u.span.ystep;
+    }
+    else
+    {
+	dc_colormap = cmd->colormap;
+	dc_source = cmd->source;
+	dc_translation = cmd->u.column.translation;
+	dc_x = cmd->u.column.x;
+	dc_yl = cmd->u.column.yl;
+	dc_yh = cmd->u.column.yh;
+	dc_iscale = cmd->u.column.iscale;
+	dc_texturemid = cmd->u.column.texturemid;
+	fuzzpos = cmd->u.column.fuzzpos;
+    }
+
+    cmd->draw();
+}
+
+
+// Columns of a texture lie next to each other in memory, so sorting
+//  by source address groups them and walks the texture in order. The
+//  key is the low bits of the address and the light level; should two
+//  textures share a key they are drawn mixed, which is only slower.
+
+static unsigned int SortKey (drawcmd_t* cmd)
+{
+    return (((uintptr_t) cmd->source & 0xffffff) << 6)
+	 | (((cmd->colormap - colormaps) >> 8) & 63);
+}
+
+// A stable LSD radix sort, so the picture does not depend on
+//  where the textures are.
+
+static void SortKeys (sortkey_t* keys, sortkey_t* temp, int count)
+{
+    int			counts[1 << SORTBITS];
+    sortkey_t*		swap;
+    int			shift;
+    int			digit;
+    int			sum;
+    int			pass;
+    int			i;
+
+    for (pass = 0; pass < SORTPASSES; ++pass)
+    {
+	shift = pass * SORTBITS;
+	memset(counts, 0, sizeof(counts));
+
+	for (i = 0; i < count; ++i)
+	{
+	    ++counts[(keys[i].key >> shift) & ((1 << SORTBITS) - 1)];
+	}
+
+	sum = 0;
+
+	for (i = 0; i < (1 << SORTBITS); ++i)
+	{
+	    digit = counts[i];
+	    counts[i] = sum;
+	    sum += digit;
+	}
+
+	for (i = 0; i < count; ++i)
+	{
+	    digit = (keys[i].key >> shift) & ((1 << SORTBITS) - 1);
+	    temp[counts[digit]++] = keys[i];
+	}
+
+	swap = keys;
+	keys = temp;
+	temp = swap;
+    }
+}
+
+static void DrawSorted (strip_t* strip, int start, int end)
+{
+    sortkey_t*		keys;
+    int			count;
+    int			i;
+
+    count = end - start;
+
+    if (count > strip->maxkeys)
+    {
+	strip->maxkeys = count * 2;
+	strip->keys = realloc(strip->keys,
+			      2 * strip->maxkeys * sizeof(*strip->keys));
+
+	if (strip->keys == NULL)
+	{
+	    I_Error("DrawSorted: failed to allocate %i keys",
+		    strip->maxkeys);
+	}
+    }
+
+    keys = strip->keys;
+
+    for (i = 0; i < count; ++i)
+    {
+	keys[i].key = SortKey(&strip->cmds[start + i]);
+	keys[i].index = start + i;
+    }
+
+    // An odd number of passes leaves the keys in the second half.
+    SortKeys(keys, keys + strip->maxkeys, count);
+
+    if (SORTPASSES & 1)
+	keys += strip->maxkeys;
+
+    for (i = 0; i < count; ++i)
+    {
+	DrawCmd(&strip->cmds[keys[i].index]);
+    }
+}
+
+
+//
+// DrawStrip
+// Run by the render threads, every thread has its own dc_ and ds_.
+//
+static void DrawStrip (int s)
+{
+    strip_t*		strip;
+    drawcmd_t*		cmd;
+    drawcmd_t*		end;
+    int			i;
+
+    strip = &strips[s];
+    cmd = strip->cmds;
+    end = strip->cmds + strip->numcmds;
+
+    if (sortdraw)
+    {
+	for (i = 0; i < strip->numbatches; ++i)
+	{
+	    DrawSorted(strip, cmd - strip->cmds, strip->batchends[i]);
+	    cmd = strip->cmds + strip->batchends[i];
+	}
+    }
+
+    for ( ; cmd < end; ++cmd)
+    {
+	DrawCmd(cmd);
+    }
+
+    strip->numcmds = 0;
+    strip->numbatches = 0;
+}
+
+
+//
+// R_EndSortedBatch
+//
+void R_EndSortedBatch (void)
+{
+    strip_t*		strip;
+    int			s;
+
+    if (!stripdrawing)
+	return;
+
+    for (s = 0; s < numstrips; ++s)
+    {
+	strip = &strips[s];
+
+	if (strip->numbatches == MAXBATCHES)
+	{
+	    I_Error("R_EndSortedBatch: more than %i batches", MAXBATCHES);
+	}
+
+	strip->batchends[strip->numbatches++] = strip->numcmds;
+    }
+}
+
+
+//
+// R_DrawStrips
+//
+void R_DrawStrips (void)
+{
+    int			queuefuzzpos;
+
+    if (!stripdrawing)
+	return;
+
+    // This thread draws strips too,
+    //  which moves its fuzzpos.
+    queuefuzzpos = fuzzpos;
+
+    I_RunThreads(DrawStrip, numstrips);
+
+    fuzzpos = queuefuzzpos;
+}
+
+
+//
+// R_SetupStrips
+//
+void R_SetupStrips (void)
+{
+    if (numthreads < 2 && !sortdraw)
+	return;
+
+    drawcolumn = basecolfunc;
+    drawfuzzcolumn = fuzzcolfunc;
+    drawtranscolumn = transcolfunc;
+    drawspan = spanfunc;
+    drawprelitcolumn = prelitcolfunc;
+    drawprelitspan = prelitspanfunc;
+
+    colfunc = basecolfunc = QueueColumn;
+    fuzzcolfunc = QueueFuzzColumn;
+    transcolfunc = QueueTranslatedColumn;
+    spanfunc = QueueSpan;
+    prelitcolfunc = QueuePrelitColumn;
+    prelitspanfunc = QueuePrelitSpan;
+
+    firststrip = viewwindowx / STRIPWIDTH;
+    numstrips = (viewwindowx + scaledviewwidth - 1) / STRIPWIDTH
+	      - firststrip + 1;
+
+    if (numstrips > maxstrips)
+    {
+	strips = realloc(strips, numstrips * sizeof(*strips));
+
+	if (strips == NULL)
+	{
+	    I_Error("R_SetupStrips: failed to allocate %i strips", numstrips);
+	}
+
+	memset(strips + maxstrips, 0,
+	       (numstrips - maxstrips) * sizeof(*strips));
+	maxstrips = numstrips;
+    }
+
+    stripdrawing = true;
+}
+
+
+// Queued columns point into the lumps until the frame is drawn, lumps
+//  which are cached rather than mapped could be purged before that.
+
+static boolean AllLumpsMapped (void)
+{
+    unsigned int	i;
+
+    for (i = 0; i < numlumps; ++i)
+    {
+	if (lumpinfo[i].wad_file->mapped == NULL)
+	    return false;
+    }
+
+    return true;
+}
+
+
+//
+// R_InitStrips
+//
+void R_InitStrips (void)
+{
+    int			p;
+    int			count;
+
+    //!
+    // @category video
+    //
+    // Queue the walls and flats of the view and draw them grouped by
+    // texture and colormap, rather than in the order they are found.
+    // The picture is the same. This needs memory mapped WAD files.
+    //
+
+    sortdraw = M_CheckParm("-sortdraw") > 0;
+
+    //!
+    // @arg <n>
+    // @category video
+    //
+    // Draw the view with n threads, each drawing vertical strips of
+    // the screen, 0 starts one per processor. The picture is the same
+    // as with one thread. This needs memory mapped WAD files.
+    //
+
+    p = M_CheckParmWithArgs("-rthreads", 1);
+    count = 1;
+
+    if (p)
+    {
+	count = atoi(myargv[p + 1]);
+
+	if (count <= 0)
+	    count = I_NumCPUs();
+    }
+
+    if (count < 2 && !sortdraw)
+	return;
+
+    if (!AllLumpsMapped())
+    {
+	printf("R_InitStrips: WAD files are not memory mapped, "
+	       "drawing with one thread, unsorted.\n");
+	sortdraw = false;
+	return;
+    }
+
+    if (count >= 2)
+	numthreads = I_InitThreads(count);
+}
@@ -0,0 +1,44 @@
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	Multithreaded drawing: columns and spans are queued by
+//	 screen strip and drawn by the render threads.
+//
+
+
+#ifndef __R_STRIP__
+#define __R_STRIP__
+
+#include "doomtype.h"
+
+// True if columns and spans are queued, rather than drawn
+//  right away.
+extern boolean		stripdrawing;
+
+// Reads -rthreads and starts the render threads.
+void R_InitStrips (void);
+
+// Replaces the drawers for the new view size
+//  with ones which queue.
+void R_SetupStrips (void);
+
+// Nothing queued since the last batch covers a pixel twice,
+//  so -sortdraw may draw it in any order.
+void R_EndSortedBatch (void);
+
+// Draws everything queued this frame.
+void R_DrawStrips (void);
+
+#endif
@@ -21,6 +21,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 
 #include "deh_main.h"
@@ -72,8 +73,13 @@ lighttable_t**	spritelights;
 
 // constant arrays
 //  used for psprite clipping and initializing clipping
-short		negonearray[SCREENWIDTH];
-short		screenheightarray[SCREENWIDTH];
+// SOKOL CHANGE: allocated for the render resolution
+short*		negonearray;
+short*		screenheightarray;
+
+// for R_DrawSprite
+static short*		clipbot;
+static short*		cliptop;
 
 
 //
@@ -278,8 +284,15 @@ void R_InitSpriteDefs (char** namelist)
 //
 // GAME FUNCTIONS
 //
-vissprite_t	vissprites[MAXVISSPRITES];
+// SOKOL CHANGE: vissprites[] grows as needed instead of dropping the
+//  sprites that do not fit, it keeps its size from frame to frame.
+vissprite_t*	vissprites;
 vissprite_t*	vissprite_p;
+static int	maxvissprites;
+
+// SOKOL CHANGE: the vissprites in drawing order, see R_SortVisSprites
+vissprite_t**		vsprsorted;
+static vissprite_t**	vsprtemp;
 int		newvissprite;
 
 
@@ -292,6 +305,13 @@ void R_InitSprites (char** namelist)
 {
     int		i;
 	
+    // SOKOL CHANGE: the render resolution is set by now
+    negonearray = Z_Malloc (SCREENWIDTH * sizeof(*negonearray), PU_STATIC, NULL);
+    screenheightarray = Z_Malloc (SCREENWIDTH * sizeof(*screenheightarray),
+				  PU_STATIC, NULL);
+    clipbot = Z_Malloc (SCREENWIDTH * sizeof(*clipbot), PU_STATIC, NULL);
+    cliptop = Z_Malloc (SCREENWIDTH * sizeof(*cliptop), PU_STATIC, NULL);
+
     for (i=0 ; i<SCREENWIDTH ; i++)
     {
 	negonearray[i] = -1;
@@ -302,12 +322,52 @@ void R_InitSprites (char** namelist)
 
 
 
+//
+// GrowVisSprites
+// Doubles the size of vissprites[].
+//
+static void GrowVisSprites (void)
+{
+    vissprite_t*	newvissprites;
+    int			used;
+
+    used = vissprite_p - vissprites;
+    maxvissprites = maxvissprites ? maxvissprites * 2 : MAXVISSPRITES;
+    newvissprites = Z_Malloc (maxvissprites * sizeof(*newvissprites),
+			      PU_STATIC, NULL);
+
+    if (vissprites != NULL)
+    {
+	memcpy (newvissprites, vissprites, used * sizeof(*vissprites));
+	Z_Free (vissprites);
+    }
+
+    vissprites = newvissprites;
+    vissprite_p = vissprites + used;
+
+    // Only used after all vissprites of the frame are in
+    if (vsprsorted != NULL)
+    {
+	Z_Free (vsprsorted);
+	Z_Free (vsprtemp);
+    }
+
+    vsprsorted = Z_Malloc (maxvissprites * sizeof(*vsprsorted),
+			   PU_STATIC, NULL);
+    vsprtemp = Z_Malloc (maxvissprites * sizeof(*vsprtemp),
+			 PU_STATIC, NULL);
+}
+
+
 //
 // R_ClearSprites
 // Called at frame start.
 //
 void R_ClearSprites (void)
 {
+    if (vissprites == NULL)
+	GrowVisSprites ();
+
     vissprite_p = vissprites;
 }
 
@@ -315,12 +375,11 @@ void R_ClearSprites (void)
 //
 // R_NewVisSprite
 //
-vissprite_t	overflowsprite;
-
 vissprite_t* R_NewVisSprite (void)
 {
-    if (vissprite_p == &vissprites[MAXVISSPRITES])
-	return &overflowsprite;
+    // SOKOL CHANGE: grow instead of dropping the sprite
+    if (vissprite_p == vissprites + maxvissprites)
+	GrowVisSprites ();
     
     vissprite_p++;
     return vissprite_p-1;
@@ -470,10 +529,33 @@ void R_ProjectSprite (mobj_t* thing)
     
     angle_t		ang;
     fixed_t		iscale;
+
+    fixed_t		gx;
+    fixed_t		gy;
+    fixed_t		gz;
+    angle_t		gangle;
+
+    // SOKOL CHANGE: on display frames between tics, drawn where
+    //  it is in between
+    if (fractionaltic != FRACUNIT && thing->oldgametic == gametic-1)
+    {
+	gx = thing->oldx + FixedMul (thing->x - thing->oldx, fractionaltic);
+	gy = thing->oldy + FixedMul (thing->y - thing->oldy, fractionaltic);
+	gz = thing->oldz + FixedMul (thing->z - thing->oldz, fractionaltic);
+	gangle = thing->oldangle
+	    + FixedMul (thing->angle - thing->oldangle, fractionaltic);
+    }
+    else
+    {
+	gx = thing->x;
+	gy = thing->y;
+	gz = thing->z;
+	gangle = thing->angle;
+    }
     
     // transform the origin point
-    tr_x = thing->x - viewx;
-    tr_y = thing->y - viewy;
+    tr_x = gx - viewx;
+    tr_y = gy - viewy;
 	
     gxt = FixedMul(tr_x,viewcos); 
     gyt = -FixedMul(tr_y,viewsin);
@@ -511,8 +593,8 @@ void R_ProjectSprite (mobj_t* thing)
     if (sprframe->rotate)
     {
 	// choose a different rotation based on player view
-	ang = R_PointToAngle (thing->x, thing->y);
-	rot = (ang-thing->angle+(unsigned)(ANG45/2)*9)>>29;
+	ang = R_PointToAngle (gx, gy);
+	rot = (ang-gangle+(unsigned)(ANG45/2)*9)>>29;
 	lump = sprframe->lump[rot];
 	flip = (boolean)sprframe->flip[rot];
     }
@@ -542,10 +624,10 @@ void R_ProjectSprite (mobj_t* thing)
     vis = R_NewVisSprite ();
     vis->mobjflags = thing->flags;
     vis->scale = xscale<<detailshift;
-    vis->gx = thing->x;
-    vis->gy = thing->y;
-    vis->gz = thing->z;
-    vis->gzt = thing->z + spritetopoffset[lump];
+    vis->gx = gx;
+    vis->gy = gy;
+    vis->gz = gz;
+    vis->gzt = gz + spritetopoffset[lump];
     vis->texturemid = vis->gzt - viewz;
     vis->x1 = x1 < 0 ? 0 : x1;
     vis->x2 = x2 >= viewwidth ? viewwidth-1 : x2;	
@@ -588,8 +670,8 @@ void R_ProjectSprite (mobj_t* thing)
 	// diminished light
 	index = xscale>>(LIGHTSCALESHIFT-detailshift);
 
-	if (index >= MAXLIGHTSCALE) 
-	    index = MAXLIGHTSCALE-1;
+	if (index >= maxlightscale) 
+	    index = maxlightscale-1;
 
 	vis->colormap = spritelights[index];
     }	
@@ -724,7 +806,7 @@ void R_DrawPSprite (pspdef_t* psp)
     else
     {
 	// local light
-	vis->colormap = spritelights[MAXLIGHTSCALE-1];
+	vis->colormap = spritelights[maxlightscale-1];
     }
 	
     R_DrawVisSprite (vis, vis->x1, vis->x2);
@@ -772,59 +854,68 @@ void R_DrawPlayerSprites (void)
 
 //
 // R_SortVisSprites
+// SOKOL CHANGE: vanilla pulled the smallest scale out of a linked
+//  list count times. This is a bottom-up merge sort of vsprsorted[],
+//  which is stable, so equal scales stay in the order they were
+//  projected in, the same order the selection sort gave.
 //
-vissprite_t	vsprsortedhead;
-
-
 void R_SortVisSprites (void)
 {
-    int			i;
     int			count;
-    vissprite_t*	ds;
-    vissprite_t*	best;
-    vissprite_t		unsorted;
-    fixed_t		bestscale;
+    int			width;
+    int			lo, mid, hi;
+    int			i, j, k;
+    vissprite_t**	src;
+    vissprite_t**	dst;
+    vissprite_t**	swap;
 
     count = vissprite_p - vissprites;
-	
-    unsorted.next = unsorted.prev = &unsorted;
 
-    if (!count)
-	return;
-		
-    for (ds=vissprites ; ds<vissprite_p ; ds++)
-    {
-	ds->next = ds+1;
-	ds->prev = ds-1;
-    }
-    
-    vissprites[0].prev = &unsorted;
-    unsorted.next = &vissprites[0];
-    (vissprite_p-1)->next = &unsorted;
-    unsorted.prev = vissprite_p-1;
-    
-    // pull the vissprites out by scale
-
-    vsprsortedhead.next = vsprsortedhead.prev = &vsprsortedhead;
     for (i=0 ; i<count ; i++)
+	vsprsorted[i] = &vissprites[i];
+
+    src = vsprsorted;
+    dst = vsprtemp;
+
+    for (width=1 ; width<count ; width*=2)
     {
-	bestscale = INT_MAX;
-        best = unsorted.next;
-	for (ds=unsorted.next ; ds!= &unsorted ; ds=ds->next)
+	for (lo=0 ; lo<count ; lo+=2*width)
 	{
-	    if (ds->scale < bestscale)
+	    mid = lo + width;
+	    hi = lo + 2*width;
+
+	    if (mid > count)
+		mid = count;
+	    if (hi > count)
+		hi = count;
+
+	    i = lo;
+	    j = mid;
+	    k = lo;
+
+	    // take from the left run unless the right one is smaller
+	    while (i < mid && j < hi)
 	    {
-		bestscale = ds->scale;
-		best = ds;
+		if (src[j]->scale < src[i]->scale)
+		    dst[k++] = src[j++];
+		else
+		    dst[k++] = src[i++];
 	    }
+
+	    while (i < mid)
+		dst[k++] = src[i++];
+
+	    while (j < hi)
+		dst[k++] = src[j++];
 	}
-	best->next->prev = best->prev;
-	best->prev->next = best->next;
-	best->next = &vsprsortedhead;
-	best->prev = vsprsortedhead.prev;
-	vsprsortedhead.prev->next = best;
-	vsprsortedhead.prev = best;
+
+	swap = src;
+	src = dst;
+	dst = swap;
     }
+
+    if (src != vsprsorted)
+	memcpy (vsprsorted, src, count * sizeof(*vsprsorted));
 }
 
 
@@ -832,8 +923,6 @@ void R_SortVisSprites (void)
 //
 // R_DrawSprite
 //
-static short		clipbot[SCREENWIDTH];
-static short		cliptop[SCREENWIDTH];
 void R_DrawSprite (vissprite_t* spr)
 {
     drawseg_t*		ds;
@@ -950,22 +1039,14 @@ void R_DrawSprite (vissprite_t* spr)
 //
 void R_DrawMasked (void)
 {
-    vissprite_t*	spr;
+    int			i;
     drawseg_t*		ds;
 	
     R_SortVisSprites ();
 
-    if (vissprite_p > vissprites)
-    {
-	// draw all vissprites back to front
-	for (spr = vsprsortedhead.next ;
-	     spr != &vsprsortedhead ;
-	     spr=spr->next)
-	{
-	    
-	    R_DrawSprite (spr);
-	}
-    }
+    // draw all vissprites back to front
+    for (i=0 ; i<vissprite_p-vissprites ; i++)
+	R_DrawSprite (vsprsorted[i]);
     
     // render any remaining masked mid textures
     for (ds=ds_p-1 ; ds >= drawsegs ; ds--)
@@ -22,16 +22,17 @@
 
 
 
+// SOKOL CHANGE: initial size, vissprites[] grows as needed
 #define MAXVISSPRITES  	128
 
-extern vissprite_t	vissprites[MAXVISSPRITES];
+extern vissprite_t*	vissprites;
 extern vissprite_t*	vissprite_p;
-extern vissprite_t	vsprsortedhead;
+extern vissprite_t**	vsprsorted;
 
 // Constant arrays used for psprite clipping
 //  and initializing clipping.
-extern short		negonearray[SCREENWIDTH];
-extern short		screenheightarray[SCREENWIDTH];
+extern short*		negonearray;
+extern short*		screenheightarray;
 
 // vars for R_DrawMaskedColumn
 extern short*		mfloorclip;
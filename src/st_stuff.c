@@ -254,7 +254,7 @@
 #define ST_OUTHEIGHT		1
 
 #define ST_MAPTITLEX \
-    (SCREENWIDTH - ST_MAPWIDTH * ST_CHATFONTWIDTH)
+    (ORIGWIDTH - ST_MAPWIDTH * ST_CHATFONTWIDTH)
 
 #define ST_MAPTITLEY		0
 #define ST_MAPHEIGHT		1
@@ -420,6 +420,11 @@ void ST_refreshBackground(void)
     {
         V_UseBuffer(st_backing_screen);
 
+	// SOKOL CHANGE: the border flat at the sides of a wide screen
+	if (widescreendelta)
+	    V_FillFlat(0, 0, SCREENWIDTH, ST_HEIGHT*screenscale,
+		       R_BorderFlat());
+
 	V_DrawPatch(ST_X, 0, sbar);
 
 	if (netgame)
@@ -427,7 +432,9 @@ void ST_refreshBackground(void)
 
         V_RestoreBuffer();
 
-	V_CopyRect(ST_X, 0, st_backing_screen, ST_WIDTH, ST_HEIGHT, ST_X, ST_Y);
+	V_CopyRect(ST_X - widescreendelta, 0, st_backing_screen,
+		   ST_WIDTH + 2*widescreendelta, ST_HEIGHT,
+		   ST_X - widescreendelta, ST_Y);
     }
 
 }
@@ -1411,6 +1418,8 @@ void ST_Stop (void)
 void ST_Init (void)
 {
     ST_loadData();
-    st_backing_screen = (byte *) Z_Malloc(ST_WIDTH * ST_HEIGHT, PU_STATIC, 0);
+    // SOKOL CHANGE: drawn to at the render resolution
+    st_backing_screen = (byte *) Z_Malloc(SCREENWIDTH * ST_HEIGHT * screenscale,
+                                          PU_STATIC, 0);
 }
 
@@ -27,9 +27,10 @@
 
 // Size of statusbar.
 // Now sensitive for scaling.
+// SOKOL CHANGE: in 320x200 units, scaled up when drawn.
 #define ST_HEIGHT	32
-#define ST_WIDTH	SCREENWIDTH
-#define ST_Y		(SCREENHEIGHT - ST_HEIGHT)
+#define ST_WIDTH	ORIGWIDTH
+#define ST_Y		(ORIGHEIGHT - ST_HEIGHT)
 
 
 //
@@ -20,6 +20,7 @@
 //
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <math.h>
 
@@ -30,6 +31,7 @@
 #include "deh_str.h"
 #include "i_swap.h"
 #include "i_video.h"
+#include "m_argv.h"
 #include "m_bbox.h"
 #include "m_misc.h"
 #include "v_video.h"
@@ -89,20 +91,33 @@ void V_CopyRect(int srcx, int srcy, byte *source,
     byte *src;
     byte *dest; 
  
+    // SOKOL CHANGE: coordinates are in 320x200 units like the patches,
+    // centered on a wide screen
+
+    srcx += widescreendelta;
+    destx += widescreendelta;
+
 #ifdef RANGECHECK 
     if (srcx < 0
-     || srcx + width > SCREENWIDTH
+     || srcx + width > SCREENWIDTH / screenscale
      || srcy < 0
-     || srcy + height > SCREENHEIGHT 
+     || srcy + height > ORIGHEIGHT 
      || destx < 0
-     || destx + width > SCREENWIDTH
+     || destx + width > SCREENWIDTH / screenscale
      || desty < 0
-     || desty + height > SCREENHEIGHT)
+     || desty + height > ORIGHEIGHT)
     {
         I_Error ("Bad V_CopyRect");
     }
 #endif 
 
+    srcx *= screenscale;
+    srcy *= screenscale;
+    destx *= screenscale;
+    desty *= screenscale;
+    width *= screenscale;
+    height *= screenscale;
+
     V_MarkRect(destx, desty, width, height); 
  
     src = source + SCREENWIDTH * srcy + srcx; 
@@ -145,10 +160,14 @@ void V_DrawPatch(int x, int y, patch_t *patch)
     byte *dest;
     byte *source;
     int w;
+    int i;
 
     y -= SHORT(patch->topoffset);
     x -= SHORT(patch->leftoffset);
 
+    // SOKOL CHANGE: centered on a wide screen
+    x += widescreendelta;
+
     // haleyjd 08/28/10: Strife needs silent error checking here.
     if(patchclip_callback)
     {
@@ -158,35 +177,38 @@ void V_DrawPatch(int x, int y, patch_t *patch)
 
 #ifdef RANGECHECK
     if (x < 0
-     || x + SHORT(patch->width) > SCREENWIDTH
+     || x + SHORT(patch->width) > SCREENWIDTH / screenscale
      || y < 0
-     || y + SHORT(patch->height) > SCREENHEIGHT)
+     || y + SHORT(patch->height) > ORIGHEIGHT)
     {
         I_Error("Bad V_DrawPatch x=%i y=%i patch.width=%i patch.height=%i topoffset=%i leftoffset=%i", x, y, patch->width, patch->height, patch->topoffset, patch->leftoffset);
     }
 #endif
 
-    V_MarkRect(x, y, SHORT(patch->width), SHORT(patch->height));
+    V_MarkRect(x * screenscale, y * screenscale,
+               SHORT(patch->width) * screenscale,
+               SHORT(patch->height) * screenscale);
 
     col = 0;
-    desttop = dest_screen + y * SCREENWIDTH + x;
+    desttop = dest_screen + (y * SCREENWIDTH + x) * screenscale;
 
-    w = SHORT(patch->width);
+    w = SHORT(patch->width) * screenscale;
 
-    for ( ; col<w ; x++, col++, desttop++)
+    for ( ; col<w ; col++, desttop++)
     {
-        column = (column_t *)((byte *)patch + LONG(patch->columnofs[col]));
+        column = (column_t *)((byte *)patch
+                              + LONG(patch->columnofs[col / screenscale]));
 
         // step through the posts in a column
         while (column->topdelta != 0xff)
         {
             source = (byte *)column + 3;
-            dest = desttop + column->topdelta*SCREENWIDTH;
-            count = column->length;
+            dest = desttop + column->topdelta * screenscale * SCREENWIDTH;
+            count = column->length * screenscale;
 
-            while (count--)
+            for (i = 0; i < count; i++)
             {
-                *dest = *source++;
+                *dest = source[i / screenscale];
                 dest += SCREENWIDTH;
             }
             column = (column_t *)((byte *)column + column->length + 4);
@@ -209,9 +231,11 @@ void V_DrawPatchFlipped(int x, int y, patch_t *patch)
     byte *dest;
     byte *source; 
     int w; 
+    int i;
  
     y -= SHORT(patch->topoffset); 
     x -= SHORT(patch->leftoffset); 
+    x += widescreendelta;
 
     // haleyjd 08/28/10: Strife needs silent error checking here.
     if(patchclip_callback)
@@ -222,35 +246,38 @@ void V_DrawPatchFlipped(int x, int y, patch_t *patch)
 
 #ifdef RANGECHECK 
     if (x < 0
-     || x + SHORT(patch->width) > SCREENWIDTH
+     || x + SHORT(patch->width) > SCREENWIDTH / screenscale
      || y < 0
-     || y + SHORT(patch->height) > SCREENHEIGHT)
+     || y + SHORT(patch->height) > ORIGHEIGHT)
     {
         I_Error("Bad V_DrawPatchFlipped");
     }
 #endif
 
-    V_MarkRect (x, y, SHORT(patch->width), SHORT(patch->height));
+    V_MarkRect(x * screenscale, y * screenscale,
+               SHORT(patch->width) * screenscale,
+               SHORT(patch->height) * screenscale);
 
     col = 0;
-    desttop = dest_screen + y * SCREENWIDTH + x;
+    desttop = dest_screen + (y * SCREENWIDTH + x) * screenscale;
 
-    w = SHORT(patch->width);
+    w = SHORT(patch->width) * screenscale;
 
-    for ( ; col<w ; x++, col++, desttop++)
+    for ( ; col<w ; col++, desttop++)
     {
-        column = (column_t *)((byte *)patch + LONG(patch->columnofs[w-1-col]));
+        column = (column_t *)((byte *)patch
+                              + LONG(patch->columnofs[(w-1-col) / screenscale]));
 
         // step through the posts in a column
         while (column->topdelta != 0xff )
         {
             source = (byte *)column + 3;
-            dest = desttop + column->topdelta*SCREENWIDTH;
-            count = column->length;
+            dest = desttop + column->topdelta * screenscale * SCREENWIDTH;
+            count = column->length * screenscale;
 
-            while (count--)
+            for (i = 0; i < count; i++)
             {
-                *dest = *source++;
+                *dest = source[i / screenscale];
                 dest += SCREENWIDTH;
             }
             column = (column_t *)((byte *)column + column->length + 4);
@@ -282,37 +309,40 @@ void V_DrawTLPatch(int x, int y, patch_t * patch)
     column_t *column;
     byte *desttop, *dest, *source;
     int w;
+    int i;
 
     y -= SHORT(patch->topoffset);
     x -= SHORT(patch->leftoffset);
+    x += widescreendelta;
 
     if (x < 0
-     || x + SHORT(patch->width) > SCREENWIDTH 
+     || x + SHORT(patch->width) > SCREENWIDTH / screenscale 
      || y < 0
-     || y + SHORT(patch->height) > SCREENHEIGHT)
+     || y + SHORT(patch->height) > ORIGHEIGHT)
     {
         I_Error("Bad V_DrawTLPatch");
     }
 
     col = 0;
-    desttop = dest_screen + y * SCREENWIDTH + x;
+    desttop = dest_screen + (y * SCREENWIDTH + x) * screenscale;
 
-    w = SHORT(patch->width);
-    for (; col < w; x++, col++, desttop++)
+    w = SHORT(patch->width) * screenscale;
+    for (; col < w; col++, desttop++)
     {
-        column = (column_t *) ((byte *) patch + LONG(patch->columnofs[col]));
+        column = (column_t *) ((byte *) patch
+                               + LONG(patch->columnofs[col / screenscale]));
 
         // step through the posts in a column
 
         while (column->topdelta != 0xff)
         {
             source = (byte *) column + 3;
-            dest = desttop + column->topdelta * SCREENWIDTH;
-            count = column->length;
+            dest = desttop + column->topdelta * screenscale * SCREENWIDTH;
+            count = column->length * screenscale;
 
-            while (count--)
+            for (i = 0; i < count; i++)
             {
-                *dest = tinttable[((*dest) << 8) + *source++];
+                *dest = tinttable[((*dest) << 8) + source[i / screenscale]];
                 dest += SCREENWIDTH;
             }
             column = (column_t *) ((byte *) column + column->length + 4);
@@ -332,9 +362,11 @@ void V_DrawXlaPatch(int x, int y, patch_t * patch)
     column_t *column;
     byte *desttop, *dest, *source;
     int w;
+    int i;
 
     y -= SHORT(patch->topoffset);
     x -= SHORT(patch->leftoffset);
+    x += widescreendelta;
 
     if(patchclip_callback)
     {
@@ -343,25 +375,25 @@ void V_DrawXlaPatch(int x, int y, patch_t * patch)
     }
 
     col = 0;
-    desttop = dest_screen + y * SCREENWIDTH + x;
+    desttop = dest_screen + (y * SCREENWIDTH + x) * screenscale;
 
-    w = SHORT(patch->width);
-    for(; col < w; x++, col++, desttop++)
+    w = SHORT(patch->width) * screenscale;
+    for(; col < w; col++, desttop++)
     {
-        column = (column_t *) ((byte *) patch + LONG(patch->columnofs[col]));
+        column = (column_t *) ((byte *) patch
+                               + LONG(patch->columnofs[col / screenscale]));
 
         // step through the posts in a column
 
         while(column->topdelta != 0xff)
         {
             source = (byte *) column + 3;
-            dest = desttop + column->topdelta * SCREENWIDTH;
-            count = column->length;
+            dest = desttop + column->topdelta * screenscale * SCREENWIDTH;
+            count = column->length * screenscale;
 
-            while(count--)
+            for(i = 0; i < count; i++)
             {
-                *dest = xlatab[*dest + ((*source) << 8)];
-                source++;
+                *dest = xlatab[*dest + (source[i / screenscale] << 8)];
                 dest += SCREENWIDTH;
             }
             column = (column_t *) ((byte *) column + column->length + 4);
@@ -381,37 +413,40 @@ void V_DrawAltTLPatch(int x, int y, patch_t * patch)
     column_t *column;
     byte *desttop, *dest, *source;
     int w;
+    int i;
 
     y -= SHORT(patch->topoffset);
     x -= SHORT(patch->leftoffset);
+    x += widescreendelta;
 
     if (x < 0
-     || x + SHORT(patch->width) > SCREENWIDTH
+     || x + SHORT(patch->width) > SCREENWIDTH / screenscale
      || y < 0
-     || y + SHORT(patch->height) > SCREENHEIGHT)
+     || y + SHORT(patch->height) > ORIGHEIGHT)
     {
         I_Error("Bad V_DrawAltTLPatch");
     }
 
     col = 0;
-    desttop = dest_screen + y * SCREENWIDTH + x;
+    desttop = dest_screen + (y * SCREENWIDTH + x) * screenscale;
 
-    w = SHORT(patch->width);
-    for (; col < w; x++, col++, desttop++)
+    w = SHORT(patch->width) * screenscale;
+    for (; col < w; col++, desttop++)
     {
-        column = (column_t *) ((byte *) patch + LONG(patch->columnofs[col]));
+        column = (column_t *) ((byte *) patch
+                               + LONG(patch->columnofs[col / screenscale]));
 
         // step through the posts in a column
 
         while (column->topdelta != 0xff)
         {
             source = (byte *) column + 3;
-            dest = desttop + column->topdelta * SCREENWIDTH;
-            count = column->length;
+            dest = desttop + column->topdelta * screenscale * SCREENWIDTH;
+            count = column->length * screenscale;
 
-            while (count--)
+            for (i = 0; i < count; i++)
             {
-                *dest = tinttable[((*dest) << 8) + *source++];
+                *dest = tinttable[((*dest) << 8) + source[i / screenscale]];
                 dest += SCREENWIDTH;
             }
             column = (column_t *) ((byte *) column + column->length + 4);
@@ -432,41 +467,44 @@ void V_DrawShadowedPatch(int x, int y, patch_t *patch)
     byte *desttop, *dest, *source;
     byte *desttop2, *dest2;
     int w;
+    int i;
 
     y -= SHORT(patch->topoffset);
     x -= SHORT(patch->leftoffset);
+    x += widescreendelta;
 
     if (x < 0
-     || x + SHORT(patch->width) > SCREENWIDTH
+     || x + SHORT(patch->width) > SCREENWIDTH / screenscale
      || y < 0
-     || y + SHORT(patch->height) > SCREENHEIGHT)
+     || y + SHORT(patch->height) > ORIGHEIGHT)
     {
         I_Error("Bad V_DrawShadowedPatch");
     }
 
     col = 0;
-    desttop = dest_screen + y * SCREENWIDTH + x;
-    desttop2 = dest_screen + (y + 2) * SCREENWIDTH + x + 2;
+    desttop = dest_screen + (y * SCREENWIDTH + x) * screenscale;
+    desttop2 = dest_screen + ((y + 2) * SCREENWIDTH + x + 2) * screenscale;
 
-    w = SHORT(patch->width);
-    for (; col < w; x++, col++, desttop++, desttop2++)
+    w = SHORT(patch->width) * screenscale;
+    for (; col < w; col++, desttop++, desttop2++)
     {
-        column = (column_t *) ((byte *) patch + LONG(patch->columnofs[col]));
+        column = (column_t *) ((byte *) patch
+                               + LONG(patch->columnofs[col / screenscale]));
 
         // step through the posts in a column
 
         while (column->topdelta != 0xff)
         {
             source = (byte *) column + 3;
-            dest = desttop + column->topdelta * SCREENWIDTH;
-            dest2 = desttop2 + column->topdelta * SCREENWIDTH;
-            count = column->length;
+            dest = desttop + column->topdelta * screenscale * SCREENWIDTH;
+            dest2 = desttop2 + column->topdelta * screenscale * SCREENWIDTH;
+            count = column->length * screenscale;
 
-            while (count--)
+            for (i = 0; i < count; i++)
             {
                 *dest2 = tinttable[((*dest2) << 8)];
                 dest2 += SCREENWIDTH;
-                *dest = *source++;
+                *dest = source[i / screenscale];
                 dest += SCREENWIDTH;
 
             }
@@ -526,6 +564,33 @@ void V_DrawBlock(int x, int y, int width, int height, byte *src)
     } 
 } 
 
+//
+// V_FillFlat
+// SOKOL CHANGE: Tile a 64x64 flat over a block of the screen, scaled
+// up like the patches. The tiles are aligned to the top left of the
+// screen.
+//
+
+void V_FillFlat(int x, int y, int width, int height, byte *flat)
+{
+    byte *dest;
+    byte *src;
+    int x1, y1;
+
+    V_MarkRect(x, y, width, height);
+
+    for (y1 = y; y1 < y + height; ++y1)
+    {
+        dest = dest_screen + y1 * SCREENWIDTH + x;
+        src = flat + ((y1 / screenscale) & 63) * 64;
+
+        for (x1 = x; x1 < x + width; ++x1)
+        {
+            *dest++ = src[(x1 / screenscale) & 63];
+        }
+    }
+}
+
 void V_DrawFilledBox(int x, int y, int w, int h, int c)
 {
     uint8_t *buf, *buf1;
@@ -588,7 +653,18 @@ void V_DrawBox(int x, int y, int w, int h, int c)
  
 void V_DrawRawScreen(byte *raw)
 {
-    memcpy(dest_screen, raw, SCREENWIDTH * SCREENHEIGHT);
+    int x, y;
+
+    // SOKOL CHANGE: the raw screen is 320x200, centered on a wide screen
+
+    for (y = 0; y < SCREENHEIGHT; y++)
+    {
+        for (x = 0; x < ORIGWIDTH * screenscale; x++)
+        {
+            dest_screen[y * SCREENWIDTH + widescreendelta * screenscale + x] =
+                raw[(y / screenscale) * ORIGWIDTH + x / screenscale];
+        }
+    }
 }
 
 //
@@ -596,9 +672,48 @@ void V_DrawRawScreen(byte *raw)
 // 
 void V_Init (void) 
 { 
-    // no-op!
+    int p;
+    int width, height;
+
     // There used to be separate screens that could be drawn to; these are
     // now handled in the upper layers.
+
+    // SOKOL CHANGE: pick the render resolution
+
+    //!
+    // @arg <n>
+    //
+    // Render at n times the original 320x200 resolution (1 to 6).
+    // The status bar, menus and other 2D graphics are scaled up.
+    //
+
+    p = M_CheckParmWithArgs("-hires", 1);
+
+    if (p)
+    {
+        I_SetScreenScale(atoi(myargv[p + 1]));
+    }
+
+    //!
+    // @arg <w>:<h>
+    //
+    // Widen the screen to the given aspect ratio, for example 16:9.
+    // The view sees more to the sides and the 2D graphics are
+    // centered. The widest is 16:5, the default is 16:10.
+    //
+
+    p = M_CheckParmWithArgs("-aspect", 1);
+
+    if (p)
+    {
+        if (sscanf(myargv[p + 1], "%d:%d", &width, &height) != 2
+         || width <= 0 || height <= 0)
+        {
+            I_Error("V_Init: invalid aspect ratio '%s'", myargv[p + 1]);
+        }
+
+        I_SetScreenAspect(width, height);
+    }
 }
 
 // Set the buffer that the code draws to.
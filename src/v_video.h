@@ -66,6 +66,10 @@ void V_DrawPatchDirect(int x, int y, patch_t *patch);
 
 void V_DrawBlock(int x, int y, int width, int height, byte *src);
 
+// Tile a flat over a block of the screen, in pixels.
+
+void V_FillFlat(int x, int y, int width, int height, byte *flat);
+
 void V_MarkRect(int x, int y, int width, int height);
 
 void V_DrawFilledBox(int x, int y, int w, int h, int c);
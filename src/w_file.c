@@ -26,13 +26,18 @@
 #include "w_file.h"
 
 
+// SOKOL CHANGE: the sokol backend streams its WAD into memory, WAD
+// files on disk go through the memory mapping (-mmap) or stdio classes
+#ifndef DOOMGENERIC_HEADLESS
 extern wad_file_class_t memio_wad_file;
+#endif
 
-/* SOKOL CHANGE
 extern wad_file_class_t stdc_wad_file;
+/* SOKOL CHANGE
 #ifdef _WIN32
 extern wad_file_class_t win32_wad_file;
 #endif
+*/
 
 #ifdef HAVE_MMAP
 extern wad_file_class_t posix_wad_file;
@@ -40,22 +45,39 @@ extern wad_file_class_t posix_wad_file;
 
 static wad_file_class_t *wad_file_classes[] = 
 {
+#ifndef DOOMGENERIC_HEADLESS
+    &memio_wad_file,
+#endif
+/* SOKOL CHANGE
 #ifdef _WIN32
     &win32_wad_file,
 #endif
+*/
 #ifdef HAVE_MMAP
     &posix_wad_file,
 #endif
     &stdc_wad_file,
 };
-*/
 
-wad_file_t *W_OpenFile(char *path)
+// SOKOL CHANGE: the classes which map files from disk are only tried
+// with -mmap
+
+static boolean IsMappingClass(wad_file_class_t *wad_class)
 {
-    return memio_wad_file.OpenFile(path);
+#ifdef HAVE_MMAP
+    if (wad_class == &posix_wad_file)
+    {
+        return true;
+    }
+#endif
+
+    return false;
+}
 
-    /* SOKOL CHANGE
+wad_file_t *W_OpenFile(char *path)
+{
     wad_file_t *result;
+    boolean use_mmap;
     int i;
 
     //!
@@ -63,10 +85,7 @@ wad_file_t *W_OpenFile(char *path)
     // directly into memory.
     //
 
-    if (!M_CheckParm("-mmap"))
-    {
-        return stdc_wad_file.OpenFile(path);
-    }
+    use_mmap = M_CheckParm("-mmap") > 0;
 
     // Try all classes in order until we find one that works
 
@@ -74,6 +93,11 @@ wad_file_t *W_OpenFile(char *path)
 
     for (i = 0; i < arrlen(wad_file_classes); ++i)
     {
+        if (!use_mmap && IsMappingClass(wad_file_classes[i]))
+        {
+            continue;
+        }
+
         result = wad_file_classes[i]->OpenFile(path);
 
         if (result != NULL)
@@ -83,7 +107,6 @@ wad_file_t *W_OpenFile(char *path)
     }
 
     return result;
-    */
 }
 
 void W_CloseFile(wad_file_t *wad)
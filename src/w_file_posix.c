@@ -0,0 +1,162 @@
+//
+// Copyright(C) 1993-1996 Id Software, Inc.
+// Copyright(C) 2005-2014 Simon Howard
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//	WAD I/O functions.
+//
+
+#include "config.h"
+
+#ifdef HAVE_MMAP
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "w_file.h"
+#include "z_zone.h"
+
+typedef struct
+{
+    wad_file_t wad;
+    int handle;
+} posix_wad_file_t;
+
+extern wad_file_class_t posix_wad_file;
+
+static boolean MapFile(posix_wad_file_t *wad, char *filename)
+{
+    void *result;
+    int protection;
+    int flags;
+
+    // Mapped area can be read and written to.  Ideally
+    // this should be read-only, as none of the Doom code should
+    // change the WAD files after being read.  However, there may
+    // be code lurking in the source that does.
+
+    protection = PROT_READ|PROT_WRITE;
+
+    // Writes to the mapped area result in private changes that are
+    // *not* written to disk.
+
+    flags = MAP_PRIVATE;
+
+    result = mmap(NULL, wad->wad.length,
+                  protection, flags,
+                  wad->handle, 0);
+
+    if (result == MAP_FAILED)
+    {
+        fprintf(stderr, "W_POSIX_OpenFile: Unable to mmap() %s - %s\n",
+                        filename, strerror(errno));
+        return false;
+    }
+
+    wad->wad.mapped = result;
+
+    return true;
+}
+
+static unsigned int GetFileLength(int handle)
+{
+    return lseek(handle, 0, SEEK_END);
+}
+
+static wad_file_t *W_POSIX_OpenFile(char *path)
+{
+    posix_wad_file_t *result;
+    int handle;
+
+    handle = open(path, O_RDONLY);
+
+    if (handle < 0)
+    {
+        return NULL;
+    }
+
+    // Create a new posix_wad_file_t to hold the file handle.
+
+    result = Z_Malloc(sizeof(posix_wad_file_t), PU_STATIC, 0);
+    result->wad.file_class = &posix_wad_file;
+    result->wad.length = GetFileLength(handle);
+    result->handle = handle;
+
+    // Try to map the file into memory with mmap. If this fails, the
+    // next class in W_OpenFile() gets a go at it.
+
+    if (!MapFile(result, path))
+    {
+        close(handle);
+        Z_Free(result);
+        return NULL;
+    }
+
+    return &result->wad;
+}
+
+static void W_POSIX_CloseFile(wad_file_t *wad)
+{
+    posix_wad_file_t *posix_wad;
+
+    posix_wad = (posix_wad_file_t *) wad;
+
+    // If mapped, unmap it.
+
+    munmap(posix_wad->wad.mapped, posix_wad->wad.length);
+
+    // Close the file
+
+    close(posix_wad->handle);
+    Z_Free(posix_wad);
+}
+
+// Read data from the specified position in the file into the
+// provided buffer.  Returns the number of bytes read.
+
+static size_t W_POSIX_Read(wad_file_t *wad, unsigned int offset,
+                           void *buffer, size_t buffer_len)
+{
+    // The whole file is mapped, copy out of the mapped region
+    // instead of going through read().
+
+    if (offset >= wad->length)
+    {
+        return 0;
+    }
+
+    if (buffer_len > wad->length - offset)
+    {
+        buffer_len = wad->length - offset;
+    }
+
+    memcpy(buffer, wad->mapped + offset, buffer_len);
+
+    return buffer_len;
+}
+
+
+wad_file_class_t posix_wad_file =
+{
+    W_POSIX_OpenFile,
+    W_POSIX_CloseFile,
+    W_POSIX_Read,
+};
+
+
+#endif /* #ifdef HAVE_MMAP */
+
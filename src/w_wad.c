@@ -413,8 +413,10 @@ void *W_CacheLumpNum(int lumpnum, int tag)
     {
         // Not yet loaded, so load it now
 
-        lump->cache = Z_Malloc(W_LumpLength(lumpnum), tag, &lump->cache);
+        // SOKOL CHANGE: padded, see LUMPPADDING
+        lump->cache = Z_Malloc(lump->size + LUMPPADDING, tag, &lump->cache);
 	W_ReadLump (lumpnum, lump->cache);
+        memset((byte *) lump->cache + lump->size, 0, LUMPPADDING);
         result = lump->cache;
     }
 	
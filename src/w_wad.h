@@ -63,6 +63,13 @@ int	W_GetNumForName (char* name);
 int	W_LumpLength (unsigned int lump);
 void    W_ReadLump (unsigned int lump, void *dest);
 
+// SOKOL CHANGE: the column drawers can read up to 128 bytes past the
+// start of the last post of a patch, beyond the end of its lump. Lumps
+// and composites kept in the zone are followed by this many zeros, so
+// those reads see the same bytes every run rather than the pointers in
+// the header of the next block.
+#define LUMPPADDING	128
+
 void*	W_CacheLumpNum (int lump, int tag);
 void*	W_CacheLumpName (char* name, int tag);
 
@@ -17,6 +17,8 @@
 //
 
 
+#include <string.h>
+
 #include "z_zone.h"
 #include "i_system.h"
 #include "doomtype.h"
@@ -27,14 +29,25 @@
 //
 // There is never any space between memblocks,
 //  and there will never be two contiguous free memblocks.
-// The rover can be left pointing at a non-empty block.
 //
 // It is of no value to free a cachable block,
 //  because it will get overwritten automatically if needed.
+//
+// SOKOL CHANGE: instead of scanning the block list from a rover, free
+// blocks are kept in segregated free lists (two-level size classes,
+// as in TLSF) which are found through bitmaps in constant time.
+// Purgable blocks are kept in a list in the order they became
+// purgable, when no free block is big enough the oldest ones are
+// purged until the allocation fits.
+//
+// SOKOL CHANGE: if that doesn't help either, the zone grows by another
+// region from I_ZoneGrow(). Every region ends in a static block which
+// keeps free blocks from being merged across regions.
 // 
  
 #define MEM_ALIGN sizeof(void *)
 #define ZONEID	0x1d4a11
+#define REGIONID	0x1d4a12
 
 typedef struct memblock_s
 {
@@ -44,18 +57,43 @@ typedef struct memblock_s
     int			id;	// should be ZONEID
     struct memblock_s*	next;
     struct memblock_s*	prev;
+
+    // free list of the size class if free, purge list if purgable
+    struct memblock_s*	nextlist;
+    struct memblock_s*	prevlist;
 } memblock_t;
 
 
+// Size classes: blocks below SMALL_BLOCK bytes are split into
+// SL_COUNT linear classes, above that every power of two is split
+// into SL_COUNT classes.
+
+#define SL_BITS		3
+#define SL_COUNT	(1 << SL_BITS)
+#define FL_MIN		8
+#define SMALL_BLOCK	(1 << FL_MIN)
+#define FL_COUNT	(32 - FL_MIN + 1)
+
+
 typedef struct
 {
-    // total bytes malloced, including header
-    int		size;
+    // total bytes malloced in all regions, including header
+    size_t	size;
 
     // start / end cap for linked list
     memblock_t	blocklist;
-    
-    memblock_t*	rover;
+
+    // free lists and bitmaps of the non-empty ones
+    unsigned int flmap;
+    unsigned int slmap[FL_COUNT];
+    memblock_t*	freelists[FL_COUNT][SL_COUNT];
+
+    // purgable blocks, oldest first
+    memblock_t	purgelist;
+
+    // bytes in free and purgable blocks
+    size_t	freebytes;
+    size_t	purgablebytes;
     
 } memzone_t;
 
@@ -64,29 +102,238 @@ typedef struct
 memzone_t*	mainzone;
 
 
+static int FindLastSet(unsigned int x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return 31 - __builtin_clz(x);
+#else
+    int result = 0;
+
+    while (x >>= 1)
+    {
+        ++result;
+    }
+
+    return result;
+#endif
+}
+
+static int FindFirstSet(unsigned int x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctz(x);
+#else
+    return FindLastSet(x & -x);
+#endif
+}
+
+static void MapSize(unsigned int size, int *fl, int *sl)
+{
+    int bit;
+
+    if (size < SMALL_BLOCK)
+    {
+        *fl = 0;
+        *sl = size / (SMALL_BLOCK / SL_COUNT);
+    }
+    else
+    {
+        bit = FindLastSet(size);
+        *fl = bit - FL_MIN + 1;
+        *sl = (size >> (bit - SL_BITS)) ^ SL_COUNT;
+    }
+}
+
+static void InsertFreeBlock(memblock_t *block)
+{
+    memblock_t **head;
+    int fl, sl;
+
+    MapSize(block->size, &fl, &sl);
+    head = &mainzone->freelists[fl][sl];
+
+    block->prevlist = NULL;
+    block->nextlist = *head;
+
+    if (*head != NULL)
+    {
+        (*head)->prevlist = block;
+    }
+
+    *head = block;
+
+    mainzone->flmap |= 1U << fl;
+    mainzone->slmap[fl] |= 1U << sl;
+    mainzone->freebytes += block->size;
+}
+
+static void RemoveFreeBlock(memblock_t *block)
+{
+    int fl, sl;
+
+    MapSize(block->size, &fl, &sl);
+
+    if (block->prevlist != NULL)
+    {
+        block->prevlist->nextlist = block->nextlist;
+    }
+    else
+    {
+        mainzone->freelists[fl][sl] = block->nextlist;
+
+        if (block->nextlist == NULL)
+        {
+            mainzone->slmap[fl] &= ~(1U << sl);
+
+            if (mainzone->slmap[fl] == 0)
+            {
+                mainzone->flmap &= ~(1U << fl);
+            }
+        }
+    }
+
+    if (block->nextlist != NULL)
+    {
+        block->nextlist->prevlist = block->prevlist;
+    }
+
+    mainzone->freebytes -= block->size;
+}
+
+// Find a free block of at least size bytes.
+
+static memblock_t *FindFreeBlock(int size)
+{
+    memblock_t *block;
+    unsigned int map;
+    int fl, sl;
+
+    // Round up to the next size class, every block in there fits.
+
+    if (size < SMALL_BLOCK)
+    {
+        MapSize(size + SMALL_BLOCK / SL_COUNT - 1, &fl, &sl);
+    }
+    else
+    {
+        MapSize(size + (1 << (FindLastSet(size) - SL_BITS)) - 1, &fl, &sl);
+    }
+
+    map = sl < SL_COUNT ? mainzone->slmap[fl] & (~0U << sl) : 0;
+
+    if (map == 0)
+    {
+        map = fl + 1 < FL_COUNT ? mainzone->flmap & (~0U << (fl + 1)) : 0;
+
+        if (map != 0)
+        {
+            fl = FindFirstSet(map);
+            map = mainzone->slmap[fl];
+        }
+    }
+
+    if (map != 0)
+    {
+        return mainzone->freelists[fl][FindFirstSet(map)];
+    }
+
+    // Nothing in the bigger classes, but a block in the class of the
+    // requested size may still be big enough.
+
+    MapSize(size, &fl, &sl);
+
+    for (block = mainzone->freelists[fl][sl];
+         block != NULL;
+         block = block->nextlist)
+    {
+        if (block->size >= size)
+        {
+            return block;
+        }
+    }
+
+    return NULL;
+}
+
+static void LinkPurgable(memblock_t *block)
+{
+    memblock_t *list = &mainzone->purgelist;
+
+    block->nextlist = list;
+    block->prevlist = list->prevlist;
+    list->prevlist->nextlist = block;
+    list->prevlist = block;
+
+    mainzone->purgablebytes += block->size;
+}
+
+static void UnlinkPurgable(memblock_t *block)
+{
+    block->prevlist->nextlist = block->nextlist;
+    block->nextlist->prevlist = block->prevlist;
+
+    mainzone->purgablebytes -= block->size;
+}
+
+
+// Add size bytes at base to the zone, as one free block followed by
+// the end of region block.
+
+static memblock_t *AddRegion(byte *base, int size)
+{
+    memblock_t*		block;
+    memblock_t*		end;
+
+    block = (memblock_t *) base;
+    end = (memblock_t *) (base + size - sizeof(memblock_t));
+
+    end->size = sizeof(memblock_t);
+    end->user = NULL;
+    end->tag = PU_STATIC;
+    end->id = REGIONID;
+
+    block->size = size - sizeof(memblock_t);
+    block->user = NULL;
+    block->tag = PU_FREE;
+    block->id = 0;
+
+    // append to the block list
+    block->prev = mainzone->blocklist.prev;
+    block->next = end;
+    end->prev = block;
+    end->next = &mainzone->blocklist;
+    block->prev->next = block;
+    mainzone->blocklist.prev = end;
+
+    InsertFreeBlock(block);
+
+    return block;
+}
+
 
 //
 // Z_ClearZone
 //
 void Z_ClearZone (memzone_t* zone)
 {
-    memblock_t*		block;
-	
-    // set the entire zone to one free block
+    // no blocks yet
     zone->blocklist.next =
-	zone->blocklist.prev =
-	block = (memblock_t *)( (byte *)zone + sizeof(memzone_t) );
+	zone->blocklist.prev = &zone->blocklist;
     
     zone->blocklist.user = (void *)zone;
     zone->blocklist.tag = PU_STATIC;
-    zone->rover = block;
-	
-    block->prev = block->next = &zone->blocklist;
-    
-    // a free block.
-    block->tag = PU_FREE;
 
-    block->size = zone->size - sizeof(memzone_t);
+    zone->purgelist.nextlist = zone->purgelist.prevlist = &zone->purgelist;
+    zone->purgablebytes = 0;
+
+    zone->freebytes = 0;
+    zone->flmap = 0;
+    memset(zone->slmap, 0, sizeof(zone->slmap));
+    memset(zone->freelists, 0, sizeof(zone->freelists));
+	
+    // set the rest of the zone to one free block
+    AddRegion((byte *) zone + sizeof(memzone_t),
+              zone->size - sizeof(memzone_t));
 }
 
 
@@ -96,27 +343,12 @@ void Z_ClearZone (memzone_t* zone)
 //
 void Z_Init (void)
 {
-    memblock_t*	block;
     int		size;
 
     mainzone = (memzone_t *)I_ZoneBase (&size);
     mainzone->size = size;
 
-    // set the entire zone to one free block
-    mainzone->blocklist.next =
-	mainzone->blocklist.prev =
-	block = (memblock_t *)( (byte *)mainzone + sizeof(memzone_t) );
-
-    mainzone->blocklist.user = (void *)mainzone;
-    mainzone->blocklist.tag = PU_STATIC;
-    mainzone->rover = block;
-	
-    block->prev = block->next = &mainzone->blocklist;
-
-    // free block
-    block->tag = PU_FREE;
-    
-    block->size = mainzone->size - sizeof(memzone_t);
+    Z_ClearZone (mainzone);
 }
 
 
@@ -139,6 +371,11 @@ void Z_Free (void* ptr)
 	    *block->user = 0;
     }
 
+    if (block->tag >= PU_PURGELEVEL)
+    {
+        UnlinkPurgable(block);
+    }
+
     // mark as free
     block->tag = PU_FREE;
     block->user = NULL;
@@ -149,13 +386,11 @@ void Z_Free (void* ptr)
     if (other->tag == PU_FREE)
     {
         // merge with previous free block
+        RemoveFreeBlock(other);
         other->size += block->size;
         other->next = block->next;
         other->next->prev = other;
 
-        if (block == mainzone->rover)
-            mainzone->rover = other;
-
         block = other;
     }
 	
@@ -163,13 +398,13 @@ void Z_Free (void* ptr)
     if (other->tag == PU_FREE)
     {
         // merge the next free block onto the end
+        RemoveFreeBlock(other);
         block->size += other->size;
         block->next = other->next;
         block->next->prev = block;
-
-        if (other == mainzone->rover)
-            mainzone->rover = block;
     }
+
+    InsertFreeBlock(block);
 }
 
 
@@ -188,66 +423,61 @@ Z_Malloc
   void*		user )
 {
     int		extra;
-    memblock_t*	start;
-    memblock_t* rover;
     memblock_t* newblock;
     memblock_t*	base;
+    memblock_t*	purged;
+    byte*	region;
+    int		regionsize;
     void *result;
 
+    if (user == NULL && tag >= PU_PURGELEVEL)
+        I_Error ("Z_Malloc: an owner is required for purgable blocks");
+
     size = (size + MEM_ALIGN - 1) & ~(MEM_ALIGN - 1);
     
-    // scan through the block list,
-    // looking for the first free block
-    // of sufficient size,
-    // throwing out any purgable blocks along the way.
-
     // account for size of block header
     size += sizeof(memblock_t);
-    
-    // if there is a free block behind the rover,
-    //  back up over them
-    base = mainzone->rover;
-    
-    if (base->prev->tag == PU_FREE)
-        base = base->prev;
-	
-    rover = base;
-    start = base->prev;
-	
-    do
+
+    base = FindFreeBlock(size);
+
+    // throw out purgable blocks, oldest first, until one of them
+    // leaves a free block of sufficient size behind
+
+    while (base == NULL)
     {
-        if (rover == start)
-        {
-            // scanned all the way around the list
-            I_Error ("Z_Malloc: failed on allocation of %i bytes", size);
-        }
-	
-        if (rover->tag != PU_FREE)
+        purged = mainzone->purgelist.nextlist;
+
+        if (purged == &mainzone->purgelist)
         {
-            if (rover->tag < PU_PURGELEVEL)
+            // nothing left to purge, add another region
+            region = I_ZoneGrow(size + sizeof(memblock_t), &regionsize);
+
+            if (region == NULL)
             {
-                // hit a block that can't be purged,
-                // so move base past it
-                base = rover = rover->next;
+                I_Error ("Z_Malloc: failed on allocation of %i bytes", size);
             }
-            else
-            {
-                // free the rover block (adding the size to base)
 
-                // the rover can be the base block
-                base = base->prev;
-                Z_Free ((byte *)rover+sizeof(memblock_t));
-                base = base->next;
-                rover = base->next;
-            }
+            mainzone->size += regionsize;
+            base = AddRegion(region, regionsize);
+            break;
         }
-        else
+
+        // the freed block is merged with its free neighbours, see
+        // where it ended up
+        if (purged->prev->tag == PU_FREE)
         {
-            rover = rover->next;
+            purged = purged->prev;
         }
 
-    } while (base->tag != PU_FREE || base->size < size);
+        Z_Free ((byte *)mainzone->purgelist.nextlist + sizeof(memblock_t));
 
+        if (purged->size >= size)
+        {
+            base = purged;
+        }
+    }
+
+    RemoveFreeBlock(base);
     
     // found a block big enough
     extra = base->size - size;
@@ -260,20 +490,25 @@ Z_Malloc
 	
         newblock->tag = PU_FREE;
         newblock->user = NULL;	
+        newblock->id = 0;
         newblock->prev = base;
         newblock->next = base->next;
         newblock->next->prev = newblock;
 
         base->next = newblock;
         base->size = size;
+
+        InsertFreeBlock(newblock);
     }
-	
-	if (user == NULL && tag >= PU_PURGELEVEL)
-	    I_Error ("Z_Malloc: an owner is required for purgable blocks");
 
     base->user = user;
     base->tag = tag;
 
+    if (tag >= PU_PURGELEVEL)
+    {
+        LinkPurgable(base);
+    }
+
     result  = (void *) ((byte *)base + sizeof(memblock_t));
 
     if (base->user)
@@ -281,9 +516,6 @@ Z_Malloc
         *base->user = result;
     }
 
-    // next allocation will start looking here
-    mainzone->rover = base->next;	
-	
     base->id = ZONEID;
     
     return result;
@@ -309,12 +541,18 @@ Z_FreeTags
 	// get link before freeing
 	next = block->next;
 
-	// free block?
-	if (block->tag == PU_FREE)
+	// free block or end of a region?
+	if (block->tag == PU_FREE || block->id == REGIONID)
 	    continue;
 	
 	if (block->tag >= lowtag && block->tag <= hightag)
+	{
+	    // the next block may be merged into this one
+	    if (next->tag == PU_FREE)
+	        next = next->next;
+
 	    Z_Free ( (byte *)block+sizeof(memblock_t));
+	}
     }
 }
 
@@ -331,8 +569,8 @@ Z_DumpHeap
 {
     memblock_t*	block;
 	
-    printf ("zone size: %i  location: %p\n",
-	    mainzone->size,mainzone);
+    printf ("zone size: %llu  location: %p\n",
+	    (unsigned long long) mainzone->size,mainzone);
     
     printf ("tag range: %i to %i\n",
 	    lowtag, hightag);
@@ -349,7 +587,8 @@ Z_DumpHeap
 	    break;
 	}
 	
-	if ( (byte *)block + block->size != (byte *)block->next)
+	if ( (byte *)block + block->size != (byte *)block->next
+	     && block->id != REGIONID)
 	    printf ("ERROR: block size does not touch the next block\n");
 
 	if ( block->next->prev != block)
@@ -368,7 +607,8 @@ void Z_FileDumpHeap (FILE* f)
 {
     memblock_t*	block;
 	
-    fprintf (f,"zone size: %i  location: %p\n",mainzone->size,mainzone);
+    fprintf (f,"zone size: %llu  location: %p\n",
+	     (unsigned long long) mainzone->size,mainzone);
 	
     for (block = mainzone->blocklist.next ; ; block = block->next)
     {
@@ -381,7 +621,8 @@ void Z_FileDumpHeap (FILE* f)
 	    break;
 	}
 	
-	if ( (byte *)block + block->size != (byte *)block->next)
+	if ( (byte *)block + block->size != (byte *)block->next
+	     && block->id != REGIONID)
 	    fprintf (f,"ERROR: block size does not touch the next block\n");
 
 	if ( block->next->prev != block)
@@ -409,7 +650,8 @@ void Z_CheckHeap (void)
 	    break;
 	}
 	
-	if ( (byte *)block + block->size != (byte *)block->next)
+	if ( (byte *)block + block->size != (byte *)block->next
+	     && block->id != REGIONID)
 	    I_Error ("Z_CheckHeap: block size does not touch the next block\n");
 
 	if ( block->next->prev != block)
@@ -440,6 +682,14 @@ void Z_ChangeTag2(void *ptr, int tag, char *file, int line)
         I_Error("%s:%i: Z_ChangeTag: an owner is required "
                 "for purgable blocks", file, line);
 
+    // (re-)append purgable blocks to the end of the purge list, so
+    // that recently used blocks are purged last
+    if (block->tag >= PU_PURGELEVEL)
+        UnlinkPurgable(block);
+
+    if (tag >= PU_PURGELEVEL)
+        LinkPurgable(block);
+
     block->tag = tag;
 }
 
@@ -463,26 +713,109 @@ void Z_ChangeUser(void *ptr, void **user)
 //
 // Z_FreeMemory
 //
-int Z_FreeMemory (void)
+size_t Z_FreeMemory (void)
 {
-    memblock_t*		block;
-    int			free;
-	
-    free = 0;
-    
-    for (block = mainzone->blocklist.next ;
-         block != &mainzone->blocklist;
-         block = block->next)
+    return mainzone->freebytes + mainzone->purgablebytes;
+}
+
+size_t Z_ZoneSize(void)
+{
+    return mainzone->size;
+}
+
+
+
+//
+// LEVEL ARENA
+//
+// SOKOL CHANGE: the level data loaded by P_SetupLevel is bump
+// allocated from one static zone block and thrown away as a whole
+// when the next level is set up, instead of being freed block by
+// block by Z_FreeTags. When a level needs more than the arena holds,
+// another chunk is chained on. On the next reset the chunks are
+// replaced by a single one big enough for all of them, so once the
+// biggest level has been loaded the arena stays one contiguous block.
+//
+
+#define ARENA_CHUNK	(256 * 1024)
+
+typedef struct arenachunk_s
+{
+    struct arenachunk_s* next;
+    int			size;	// not including the header
+    int			used;
+} arenachunk_t;
+
+static arenachunk_t*	arena;
+
+
+static arenachunk_t *NewArenaChunk(int size, arenachunk_t *next)
+{
+    arenachunk_t*	chunk;
+
+    chunk = Z_Malloc(sizeof(arenachunk_t) + size, PU_STATIC, NULL);
+    chunk->next = next;
+    chunk->size = size;
+    chunk->used = 0;
+
+    return chunk;
+}
+
+
+//
+// Z_ArenaMalloc
+// The memory lives until the next Z_ArenaReset,
+// it can't be freed or retagged on its own.
+//
+void *Z_ArenaMalloc(int size)
+{
+    void*		result;
+
+    size = (size + MEM_ALIGN - 1) & ~(MEM_ALIGN - 1);
+
+    if (arena == NULL || arena->used + size > arena->size)
     {
-        if (block->tag == PU_FREE || block->tag >= PU_PURGELEVEL)
-            free += block->size;
+        arena = NewArenaChunk(size > ARENA_CHUNK ? size : ARENA_CHUNK,
+                              arena);
     }
 
-    return free;
+    result = (byte *) arena + sizeof(arenachunk_t) + arena->used;
+    arena->used += size;
+
+    return result;
 }
 
-unsigned int Z_ZoneSize(void)
+
+//
+// Z_ArenaReset
+//
+void Z_ArenaReset(void)
 {
-    return mainzone->size;
-}
+    arenachunk_t*	chunk;
+    arenachunk_t*	next;
+    int			total;
+
+    if (arena == NULL)
+    {
+        return;
+    }
+
+    if (arena->next == NULL)
+    {
+        arena->used = 0;
+        return;
+    }
 
+    // last level didn't fit, merge the chunks
+
+    total = 0;
+
+    for (chunk = arena; chunk != NULL; chunk = next)
+    {
+        next = chunk->next;
+        total += chunk->size;
+        Z_Free(chunk);
+    }
+
+    arena = NewArenaChunk(total, NULL);
+}
@@ -59,8 +59,12 @@ void    Z_FileDumpHeap (FILE *f);
 void    Z_CheckHeap (void);
 void    Z_ChangeTag2 (void *ptr, int tag, char *file, int line);
 void    Z_ChangeUser(void *ptr, void **user);
-int     Z_FreeMemory (void);
-unsigned int Z_ZoneSize(void);
+size_t  Z_FreeMemory (void);
+size_t  Z_ZoneSize(void);
+
+// Level lifetime data, all released at once by Z_ArenaReset.
+void*   Z_ArenaMalloc (int size);
+void    Z_ArenaReset (void);
 
 //
 // This is used to get the local FILE:LINE info from CPP